@@ -31,13 +31,10 @@ uniform PointLight point_lights[4];
 uniform uint point_light_count;
 uniform SpotLight player_flashlight;
 
-uniform sampler2DArray u_texture_array;
-uniform uint frame;
+uniform sampler2D u_texture;
 uniform uint flashlight_on;
 uniform uint lighting_enabled;
 
-uniform uint flip_h;
-
 vec3 calculate_point_light(PointLight light, vec3 normal, vec3 frag_pos, vec3 view_direction);
 vec3 calculate_spot_light(SpotLight light, vec3 normal, vec3 frag_pos, vec3 view_direction);
 
@@ -57,11 +54,7 @@ void main() {
         light_result = vec3(1.0, 1.0, 1.0);
     }
 
-    vec3 sample_coordinate = vec3(texture_coordinate.x, texture_coordinate.y, frame);
-    if (flip_h == 1) {
-        sample_coordinate.x = 1.0 - sample_coordinate.x;
-    }
-    vec4 sampled = texture(u_texture_array, sample_coordinate);
+    vec4 sampled = texture(u_texture, texture_coordinate);
     if (sampled.a < 0.1) {
         discard;
     }
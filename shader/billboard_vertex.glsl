@@ -7,6 +7,9 @@ out vec3 frag_pos;
 
 uniform ivec2 extents;
 uniform ivec2 screen_size;
+uniform vec4 frame_rect;
+uniform vec4 frame_quad;
+uniform uint flip_h;
 
 uniform vec3 view_pos;
 uniform mat4 projection;
@@ -14,8 +17,12 @@ uniform mat4 view;
 uniform mat4 model;
 
 void main() {
-    frag_pos = vec3(model * vec4((a_pos.x * extents.x) / (screen_size.x / 2), (a_pos.y * extents.y) / (screen_size.y / 2), 0.0, 1.0));
+    // the quad only covers the trimmed part of the frame, mirroring it flips the sprite without touching the texture coordinates
+    vec2 quad_pos = mix(frame_quad.xy, frame_quad.zw, a_texture_coordinate);
+    if (flip_h == 1) {
+        quad_pos.x = -quad_pos.x;
+    }
+    frag_pos = vec3(model * vec4((quad_pos.x * extents.x) / (screen_size.x / 2), (quad_pos.y * extents.y) / (screen_size.y / 2), 0.0, 1.0));
     gl_Position = projection * view * vec4(frag_pos, 1.0);
-    // frag_pos = vec3(model * vec4(a_pos.x, a_pos.y, 0.0, 1.0));
-    texture_coordinate = a_texture_coordinate;
+    texture_coordinate = mix(frame_rect.xy, frame_rect.zw, a_texture_coordinate);
 }
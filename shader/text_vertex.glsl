@@ -1,14 +1,13 @@
 #version 410 core
-layout (location = 0) in vec2 vertex;
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_texture_coordinate;
+layout (location = 2) in vec3 a_color;
 out vec2 tex_coords;
-out vec2 vertex_pos;
-uniform int glyph_size;
+out vec3 text_color;
 uniform mat4 projection;
-uniform vec2 glyph_coords;
-uniform vec2 texture_coords;
 
 void main() {
-    gl_Position = projection * vec4(glyph_coords + (vertex * glyph_size), 0.0, 1.0);
-    tex_coords = texture_coords;
-    vertex_pos = vertex;
+    gl_Position = projection * vec4(a_pos, 0.0, 1.0);
+    tex_coords = a_texture_coordinate;
+    text_color = a_color;
 }
@@ -1,14 +1,27 @@
 #include "animation.hpp"
 
+#include <cstdio>
+
 Animation::Animation() {
     frame = 0;
     animation = 0;
     timer = 0.0f;
     is_finished = false;
+    for (unsigned int i = 0; i < ANIMATION_MAX_COUNT; i++) {
+        animation_info[i] = {
+            .start_frame = 0,
+            .end_frame = 0,
+            .frame_time = 0.0f
+        };
+    }
 }
 
 void Animation::add_animation(unsigned int name, AnimationInfo info) {
-    animation_info.insert(std::pair<unsigned int, AnimationInfo>(name, info));
+    if (name >= ANIMATION_MAX_COUNT) {
+        printf("Animation %u is past the last one an animation can hold\n", name);
+        return;
+    }
+    animation_info[name] = info;
 }
 
 void Animation::set_animation(unsigned int name) {
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <map>
+// enough for the player's and the enemies' animations, a fixed table so copying an animation never allocates
+const unsigned int ANIMATION_MAX_COUNT = 4;
 
 struct AnimationInfo {
     unsigned int start_frame;
@@ -13,7 +14,7 @@ struct Animation {
     unsigned int animation;
     float timer;
     bool is_finished;
-    std::map<unsigned int, AnimationInfo> animation_info;
+    AnimationInfo animation_info[ANIMATION_MAX_COUNT];
 
     Animation();
     void add_animation(unsigned int name, AnimationInfo info);
@@ -0,0 +1,76 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+// enough for a frame of the test map several times over, the arena grows if a frame needs more
+const size_t ARENA_INITIAL_SIZE = 64 * 1024;
+
+struct Arena {
+    char* memory = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    // allocations that didn't fit, they're freed on the next reset and the arena grows to fit them from then on
+    std::vector<char*> overflow;
+    size_t overflow_size = 0;
+
+    ~Arena() {
+        delete[] memory;
+        for (char* block : overflow) {
+            delete[] block;
+        }
+    }
+};
+
+thread_local Arena arena;
+
+void* arena_allocate(size_t size, size_t alignment) {
+    if (arena.memory == nullptr) {
+        arena.memory = new char[ARENA_INITIAL_SIZE];
+        arena.capacity = ARENA_INITIAL_SIZE;
+    }
+
+    // new[] aligns the block for any type, so aligning the offset aligns the pointer
+    size_t offset = (arena.used + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= arena.capacity) {
+        arena.used = offset + size;
+        return arena.memory + offset;
+    }
+
+    char* block = new char[size];
+    arena.overflow.push_back(block);
+    arena.overflow_size += size;
+    return block;
+}
+
+void arena_reset() {
+    if (!arena.overflow.empty()) {
+        size_t capacity = std::max(arena.capacity * 2, arena.capacity + arena.overflow_size);
+        for (char* block : arena.overflow) {
+            delete[] block;
+        }
+        arena.overflow.clear();
+        arena.overflow_size = 0;
+
+        delete[] arena.memory;
+        arena.memory = new char[capacity];
+        arena.capacity = capacity;
+    }
+    arena.used = 0;
+}
+
+const char* arena_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list length_args;
+    va_copy(length_args, args);
+    int length = vsnprintf(nullptr, 0, format, length_args);
+    va_end(length_args);
+
+    char* text = (char*)arena_allocate(length + 1, 1);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+
+    return text;
+}
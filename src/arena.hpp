@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// a linear allocator for data that only lives for one frame, allocating moves an offset along and nothing is freed
+// until arena_reset, each thread has its own arena so the simulation and the renderer never share one
+// the simulation resets its thread's arena at the start of every scene_advance, and the main loop at the start of every frame
+
+void* arena_allocate(size_t size, size_t alignment);
+// everything this thread allocated on its arena since the last reset is invalid afterwards
+void arena_reset();
+// formats into the arena, for text that's only drawn this frame
+const char* arena_printf(const char* format, ...);
+
+// lets STL containers allocate from the arena, deallocating does nothing until the reset
+template <typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    ArenaAllocator() { }
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) { }
+
+    T* allocate(size_t count) {
+        return (T*)arena_allocate(count * sizeof(T), alignof(T));
+    }
+    void deallocate(T*, size_t) { }
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+    return false;
+}
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
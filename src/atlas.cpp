@@ -0,0 +1,141 @@
+#include "atlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// frames are placed on a grid this size with at least this much empty space around them,
+// that way the first ATLAS_MIP_LEVELS mip levels never blend two frames together
+const unsigned int ATLAS_ALIGNMENT = 1 << ATLAS_MIP_LEVELS;
+
+struct TrimRect {
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+};
+
+unsigned int atlas_align(unsigned int value) {
+    return (value + ATLAS_ALIGNMENT - 1) & ~(ATLAS_ALIGNMENT - 1);
+}
+
+void atlas_pack(Atlas* atlas, const std::vector<unsigned char*>& frame_pixels, unsigned int frame_width, unsigned int frame_height) {
+    // trim transparent borders
+    std::vector<TrimRect> trim_rects;
+    for (unsigned char* pixels : frame_pixels) {
+        unsigned int min_x = frame_width;
+        unsigned int min_y = frame_height;
+        unsigned int max_x = 0;
+        unsigned int max_y = 0;
+        for (unsigned int y = 0; y < frame_height; y++) {
+            for (unsigned int x = 0; x < frame_width; x++) {
+                if (pixels[(((y * frame_width) + x) * 4) + 3] == 0) {
+                    continue;
+                }
+                min_x = std::min(min_x, x);
+                min_y = std::min(min_y, y);
+                max_x = std::max(max_x, x);
+                max_y = std::max(max_y, y);
+            }
+        }
+
+        // a fully transparent frame still needs a rect, so give it a single transparent pixel
+        if (min_x > max_x) {
+            trim_rects.push_back({ .x = 0, .y = 0, .width = 1, .height = 1 });
+        } else {
+            trim_rects.push_back({ .x = min_x, .y = min_y, .width = (max_x - min_x) + 1, .height = (max_y - min_y) + 1 });
+        }
+    }
+
+    // animations often hold a frame for a while, so identical frames share one spot in the atlas
+    std::vector<unsigned int> duplicate_of;
+    for (unsigned int i = 0; i < trim_rects.size(); i++) {
+        duplicate_of.push_back(i);
+        for (unsigned int j = 0; j < i; j++) {
+            if (duplicate_of[j] != j || trim_rects[i].x != trim_rects[j].x || trim_rects[i].y != trim_rects[j].y ||
+                trim_rects[i].width != trim_rects[j].width || trim_rects[i].height != trim_rects[j].height) {
+                continue;
+            }
+
+            bool is_same = true;
+            for (unsigned int y = 0; y < trim_rects[i].height && is_same; y++) {
+                unsigned int row_offset = (((trim_rects[i].y + y) * frame_width) + trim_rects[i].x) * 4;
+                is_same = memcmp(frame_pixels[i] + row_offset, frame_pixels[j] + row_offset, trim_rects[i].width * 4) == 0;
+            }
+            if (is_same) {
+                duplicate_of[i] = j;
+                break;
+            }
+        }
+    }
+
+    // pick a roughly square atlas width that fits the widest frame
+    unsigned long total_area = 0;
+    unsigned int widest = 0;
+    for (unsigned int i = 0; i < trim_rects.size(); i++) {
+        if (duplicate_of[i] != i) {
+            continue;
+        }
+        total_area += (atlas_align(trim_rects[i].width) + ATLAS_ALIGNMENT) * (atlas_align(trim_rects[i].height) + ATLAS_ALIGNMENT);
+        widest = std::max(widest, atlas_align(trim_rects[i].width) + (2 * ATLAS_ALIGNMENT));
+    }
+    atlas->width = std::max(widest, atlas_align((unsigned int)std::ceil(std::sqrt((double)total_area))));
+
+    // shelf pack, tallest frames first so that each shelf wastes as little height as possible
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < trim_rects.size(); i++) {
+        if (duplicate_of[i] == i) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&trim_rects](unsigned int a, unsigned int b) {
+        return trim_rects[a].height > trim_rects[b].height;
+    });
+
+    std::vector<glm::uvec2> positions(trim_rects.size());
+    unsigned int shelf_x = ATLAS_ALIGNMENT;
+    unsigned int shelf_y = ATLAS_ALIGNMENT;
+    unsigned int shelf_height = 0;
+    for (unsigned int index : order) {
+        unsigned int padded_width = atlas_align(trim_rects[index].width);
+        unsigned int padded_height = atlas_align(trim_rects[index].height);
+        if (shelf_x + padded_width + ATLAS_ALIGNMENT > atlas->width) {
+            shelf_x = ATLAS_ALIGNMENT;
+            shelf_y += shelf_height + ATLAS_ALIGNMENT;
+            shelf_height = 0;
+        }
+
+        positions[index] = glm::uvec2(shelf_x, shelf_y);
+        shelf_x += padded_width + ATLAS_ALIGNMENT;
+        shelf_height = std::max(shelf_height, padded_height);
+    }
+    atlas->height = shelf_y + shelf_height + ATLAS_ALIGNMENT;
+    for (unsigned int i = 0; i < trim_rects.size(); i++) {
+        positions[i] = positions[duplicate_of[i]];
+    }
+
+    // copy frames into the atlas
+    atlas->pixels.assign(atlas->width * atlas->height * 4, 0);
+    atlas->frames.clear();
+    for (unsigned int i = 0; i < trim_rects.size(); i++) {
+        const TrimRect& rect = trim_rects[i];
+        for (unsigned int y = 0; y < rect.height && duplicate_of[i] == i; y++) {
+            const unsigned char* src = frame_pixels[i] + ((((rect.y + y) * frame_width) + rect.x) * 4);
+            unsigned char* dst = &atlas->pixels[(((positions[i].y + y) * atlas->width) + positions[i].x) * 4];
+            memcpy(dst, src, rect.width * 4);
+        }
+
+        atlas->frames.push_back({
+            .uv_rect = glm::vec4(
+                    positions[i].x / (float)atlas->width,
+                    positions[i].y / (float)atlas->height,
+                    (positions[i].x + rect.width) / (float)atlas->width,
+                    (positions[i].y + rect.height) / (float)atlas->height),
+            .quad_rect = glm::vec4(
+                    ((rect.x / (float)frame_width) * 2.0f) - 1.0f,
+                    ((rect.y / (float)frame_height) * 2.0f) - 1.0f,
+                    (((rect.x + rect.width) / (float)frame_width) * 2.0f) - 1.0f,
+                    (((rect.y + rect.height) / (float)frame_height) * 2.0f) - 1.0f)
+        });
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+const unsigned int ATLAS_MIP_LEVELS = 2;
+
+struct AtlasFrame {
+    // min and max texture coordinates of the frame inside the atlas
+    glm::vec4 uv_rect;
+    // min and max corners of the trimmed frame inside the untrimmed frame's [-1, 1] quad
+    glm::vec4 quad_rect;
+};
+
+struct Atlas {
+    unsigned int width;
+    unsigned int height;
+    std::vector<unsigned char> pixels;
+    std::vector<AtlasFrame> frames;
+};
+
+// frame_pixels are RGBA images of frame_width x frame_height each
+// frames are trimmed down to their non-transparent pixels and shelf packed into a single RGBA image
+void atlas_pack(Atlas* atlas, const std::vector<unsigned char*>& frame_pixels, unsigned int frame_width, unsigned int frame_height);
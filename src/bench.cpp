@@ -0,0 +1,227 @@
+#include "bench.hpp"
+
+#include "scene.hpp"
+#include "stats.hpp"
+
+#include <glad/glad.h>
+#include <contrib/rapidjson/include/rapidjson/filewritestream.h>
+#include <contrib/rapidjson/include/rapidjson/writer.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+struct BenchPoint {
+    glm::vec3 position;
+    // yaw, pitch and roll in degrees
+    glm::vec3 angles;
+};
+
+struct BenchFrame {
+    float frame_time;
+    float cpu_time;
+    float gpu_time;
+    unsigned int draw_calls;
+    unsigned int triangles;
+    unsigned int sectors_visible;
+};
+
+struct BenchSummary {
+    float mean;
+    float p50;
+    float p95;
+    float p99;
+    float max;
+};
+
+std::string bench_path;
+std::vector<BenchPoint> bench_points;
+unsigned int bench_frame_count = 0;
+std::vector<BenchFrame> bench_frames;
+// a timestamp at the start of each frame and one once it's submitted, only read back at the end so the GPU never stalls
+std::vector<unsigned int> bench_queries;
+std::chrono::steady_clock::time_point bench_frame_start;
+float bench_frame_cpu_time;
+
+bool bench_init(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        printf("Unable to open bench path %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        BenchPoint point;
+        unsigned int frames;
+        if (sscanf(line.c_str(), "frames %u", &frames) == 1) {
+            bench_frame_count = frames;
+        } else if (sscanf(line.c_str(), "point %f %f %f %f %f %f", &point.position.x, &point.position.y, &point.position.z,
+                          &point.angles.x, &point.angles.y, &point.angles.z) == 6) {
+            bench_points.push_back(point);
+        }
+    }
+    if (bench_frame_count == 0 || bench_points.size() < 2) {
+        printf("Bench path %s needs a frame count and at least two points\n", path.c_str());
+        return false;
+    }
+
+    bench_path = path;
+    bench_frames.reserve(bench_frame_count);
+    bench_queries.resize(bench_frame_count * 2);
+    glGenQueries(bench_queries.size(), bench_queries.data());
+    return true;
+}
+
+// catmull-rom, passes through every point
+glm::vec3 bench_spline(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + ((p2 - p0) * t) + (((2.0f * p0) - (5.0f * p1) + (4.0f * p2) - p3) * t2) + ((-p0 + (3.0f * p1) - (3.0f * p2) + p3) * t3));
+}
+
+void bench_frame_begin() {
+    unsigned int frame = bench_frames.size();
+    unsigned int last_point = bench_points.size() - 1;
+    float progress = bench_frame_count == 1 ? 0.0f : ((float)frame / (bench_frame_count - 1)) * last_point;
+    unsigned int segment = std::min((unsigned int)progress, last_point - 1);
+    float t = progress - segment;
+
+    // the end points are repeated, so the path starts and stops on them
+    const BenchPoint& p0 = bench_points[segment == 0 ? 0 : segment - 1];
+    const BenchPoint& p1 = bench_points[segment];
+    const BenchPoint& p2 = bench_points[segment + 1];
+    const BenchPoint& p3 = bench_points[std::min(segment + 2, last_point)];
+    glm::vec3 position = bench_spline(p0.position, p1.position, p2.position, p3.position, t);
+    glm::vec3 angles = bench_spline(p0.angles, p1.angles, p2.angles, p3.angles, t);
+
+    glm::mat4 basis = glm::rotate(glm::mat4(1.0f), glm::radians(angles.x), glm::vec3(0.0f, 1.0f, 0.0f));
+    basis = glm::rotate(basis, glm::radians(angles.y), glm::vec3(1.0f, 0.0f, 0.0f));
+    basis = glm::rotate(basis, glm::radians(angles.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+    // the previous state matches, so the capture lands on the point whatever it interpolates by
+    player.position = position;
+    player.basis = basis;
+    player.direction = -glm::vec3(basis[2]);
+    player.flashlight_direction = player.direction;
+    player.previous_position = player.position;
+    player.previous_basis = player.basis;
+    player.previous_direction = player.direction;
+    player.previous_flashlight_direction = player.flashlight_direction;
+
+    glQueryCounter(bench_queries[frame * 2], GL_TIMESTAMP);
+    bench_frame_start = std::chrono::steady_clock::now();
+}
+
+void bench_frame_submitted() {
+    glQueryCounter(bench_queries[(bench_frames.size() * 2) + 1], GL_TIMESTAMP);
+    bench_frame_cpu_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - bench_frame_start).count();
+}
+
+bool bench_frame_end() {
+    bench_frames.push_back({
+        .frame_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - bench_frame_start).count(),
+        .cpu_time = bench_frame_cpu_time,
+        // filled in from the queries by bench_report
+        .gpu_time = 0.0f,
+        .draw_calls = stats_last_frame(STAT_DRAW_CALLS),
+        .triangles = stats_last_frame(STAT_TRIANGLES),
+        .sectors_visible = stats_last_frame(STAT_SECTORS_VISIBLE)
+    });
+
+    return bench_frames.size() < bench_frame_count;
+}
+
+BenchSummary bench_summarize(std::vector<float> values) {
+    if (values.empty()) {
+        return { .mean = 0.0f, .p50 = 0.0f, .p95 = 0.0f, .p99 = 0.0f, .max = 0.0f };
+    }
+
+    std::sort(values.begin(), values.end());
+    float sum = 0.0f;
+    for (float value : values) {
+        sum += value;
+    }
+    return {
+        .mean = sum / values.size(),
+        .p50 = values[stats_percentile_rank(values.size(), 50)],
+        .p95 = values[stats_percentile_rank(values.size(), 95)],
+        .p99 = values[stats_percentile_rank(values.size(), 99)],
+        .max = values.back()
+    };
+}
+
+bool bench_report(const std::string& path) {
+    for (unsigned int frame = 0; frame < bench_frames.size(); frame++) {
+        GLuint64 start;
+        GLuint64 end;
+        glGetQueryObjectui64v(bench_queries[frame * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(bench_queries[(frame * 2) + 1], GL_QUERY_RESULT, &end);
+        bench_frames[frame].gpu_time = (end - start) / 1000000.0f;
+    }
+    glDeleteQueries(bench_queries.size(), bench_queries.data());
+
+    const char* names[] = { "frame_time", "cpu_time", "gpu_time", "draw_calls", "triangles", "sectors_visible" };
+    const unsigned int NAME_COUNT = 6;
+    std::vector<float> values[NAME_COUNT];
+    for (const BenchFrame& frame : bench_frames) {
+        values[0].push_back(frame.frame_time);
+        values[1].push_back(frame.cpu_time);
+        values[2].push_back(frame.gpu_time);
+        values[3].push_back(frame.draw_calls);
+        values[4].push_back(frame.triangles);
+        values[5].push_back(frame.sectors_visible);
+    }
+
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    printf("Bench %s, %zu frames on %s\n", bench_path.c_str(), bench_frames.size(), renderer);
+    printf("  %-16s%10s%10s%10s%10s%10s\n", "", "mean", "p50", "p95", "p99", "max");
+    BenchSummary summaries[NAME_COUNT];
+    for (unsigned int i = 0; i < NAME_COUNT; i++) {
+        summaries[i] = bench_summarize(values[i]);
+        // the first three are times in milliseconds, the rest are counts
+        const char* format = i < 3 ? "  %-16s%10.3f%10.3f%10.3f%10.3f%10.3f\n" : "  %-16s%10.1f%10.0f%10.0f%10.0f%10.0f\n";
+        printf(format, names[i], summaries[i].mean, summaries[i].p50, summaries[i].p95, summaries[i].p99, summaries[i].max);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        printf("Unable to write bench report %s\n", path.c_str());
+        return false;
+    }
+
+    // the path and renderer string can hold anything, the writer escapes them
+    char buffer[4096];
+    rapidjson::FileWriteStream stream(file, buffer, sizeof(buffer));
+    rapidjson::Writer<rapidjson::FileWriteStream> writer(stream);
+    writer.StartObject();
+    writer.Key("path");
+    writer.String(bench_path.c_str());
+    writer.Key("renderer");
+    writer.String(renderer != NULL ? renderer : "");
+    writer.Key("frames");
+    writer.Uint(bench_frames.size());
+    for (unsigned int i = 0; i < NAME_COUNT; i++) {
+        writer.Key(names[i]);
+        writer.StartObject();
+        writer.Key("mean");
+        writer.Double(summaries[i].mean);
+        writer.Key("p50");
+        writer.Double(summaries[i].p50);
+        writer.Key("p95");
+        writer.Double(summaries[i].p95);
+        writer.Key("p99");
+        writer.Double(summaries[i].p99);
+        writer.Key("max");
+        writer.Double(summaries[i].max);
+        writer.EndObject();
+    }
+    writer.EndObject();
+    stream.Flush();
+    fclose(file);
+    printf("Wrote bench report to %s\n", path.c_str());
+
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// flies the camera along a spline through the level for a fixed number of frames and reports frame time percentiles,
+// the frames go through the same capture and render path as the game, only the simulation is left out
+
+// a path file has one "frames <count>" line and at least two "point <x> <y> <z> <yaw> <pitch> <roll>" lines, angles in degrees
+bool bench_init(const std::string& path);
+// places the camera for the next frame, before frame_begin
+void bench_frame_begin();
+// after the frame's draw calls have been submitted, before the swap
+void bench_frame_submitted();
+// after the swap and stats_frame_end, returns false once every frame has run
+bool bench_frame_end();
+// prints the results and writes them as JSON
+bool bench_report(const std::string& path);
@@ -0,0 +1,20 @@
+#include "billboard.hpp"
+
+#include "resource.hpp"
+#include "shader.hpp"
+#include "globals.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+void billboard_draw(const std::vector<Billboard>& billboards) {
+    glBindVertexArray(quad_vao);
+    for (const Billboard& billboard : billboards) {
+        resource_bind_sprite(billboard.sprite, billboard.frame);
+        glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "model"), 1, GL_FALSE, glm::value_ptr(billboard.model));
+        glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(billboard.normal));
+        glUniform1ui(glGetUniformLocation(billboard_shader, "flip_h"), billboard.flip_h);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glBindVertexArray(0);
+}
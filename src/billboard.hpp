@@ -0,0 +1,19 @@
+#pragma once
+
+#include "resource.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// a sprite quad drawn with the billboard shader
+// they're recorded while capturing a frame and drawn later, so recording them needs no GL
+struct Billboard {
+    ResourceHandle sprite;
+    unsigned int frame;
+    glm::mat4 model;
+    glm::vec3 normal;
+    bool flip_h;
+};
+
+// expects the billboard shader to be in use with its view and projection set
+void billboard_draw(const std::vector<Billboard>& billboards);
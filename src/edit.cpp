@@ -3,6 +3,8 @@
 #include "globals.hpp"
 #include "input.hpp"
 #include "level.hpp"
+#include "pick.hpp"
+#include "undo.hpp"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -21,22 +23,17 @@ enum Mode {
     MODE_SAVED_FILE
 };
 
-enum ObjectType {
-    OBJECT_PLAYER,
-    OBJECT_ENEMY,
-    OBJECT_LIGHT
-};
-
-struct ObjectSelection {
-    ObjectType type;
-    unsigned int index;
-};
-
 SDL_Window* edit_window;
 SDL_Renderer* renderer;
 
 TTF_Font* font;
 
+// printable ascii is rendered into one texture once, strings are then drawn glyph by glyph out of it
+const char FIRST_GLYPH = 32;
+const char LAST_GLYPH = 126;
+SDL_Texture* glyph_texture;
+SDL_Rect glyph_rects[LAST_GLYPH - FIRST_GLYPH + 1];
+
 SDL_Texture* textures[NUM_TEXTURES];
 
 const SDL_Color vertex_color = { .r = 255, .g = 255, .b = 255, .a = 255 };
@@ -65,7 +62,17 @@ std::vector<ObjectSelection> object_selections;
 bool dragging = false;
 int dragging_vertex = -1;
 glm::ivec2 drag_origin;
-bool changing_floor_or_ceiling = false;
+bool box_selecting = false;
+glm::ivec2 box_select_origin;
+// what the current drag has moved so far, it's recorded as one undo step when the drag ends
+glm::vec2 drag_total_movement = glm::vec2(0.0f);
+
+// height changes last for as long as the key is held, so they're also recorded once at the end
+int height_edit_sector = -1;
+SectorProperties height_edit_before;
+bool is_editing_object_height = false;
+ObjectSelection height_edit_object;
+float height_edit_object_y;
 
 unsigned int text_y_offset;
 std::vector<SDL_Rect> ui_hover_box;
@@ -76,11 +83,106 @@ ObjectType new_object_type;
 
 unsigned int current_texture = 0;
 
+// the grid and every unselected sector only change with the camera or the selection, so they're cached in map_layer
+SDL_Texture* map_layer;
+glm::ivec2 map_layer_size;
+bool map_layer_dirty = true;
+bool needs_redraw = true;
+
 bool is_mouse_in_rect(SDL_Rect& r) {
     return !(input.mouse_raw_x < r.x || input.mouse_raw_x > r.x + r.w || input.mouse_raw_y < r.y || input.mouse_raw_y > r.y + r.h);
 }
 
+// the clickable square around a vertex or object, in window coordinates
+SDL_Rect edit_handle_rect(glm::vec2 position) {
+    return (SDL_Rect){
+        .x = (4 * ((int)(position.x * 8.0f) + camera_offset.x) - 2),
+        .y = (4 * ((int)(position.y * 8.0f) + camera_offset.y) - 2),
+        .w = 8,
+        .h = 8
+    };
+}
+
+glm::vec2 edit_screen_to_map(glm::vec2 screen_position) {
+    return ((screen_position / 4.0f) - glm::vec2(camera_offset)) / 8.0f;
+}
+
+glm::vec3 edit_object_position(ObjectSelection object) {
+    if (object.type == OBJECT_ENEMY) {
+        return enemy_spawns[object.index].position;
+    } else if (object.type == OBJECT_LIGHT) {
+        return lights[object.index].position;
+    }
+    return player_spawn_point;
+}
+
+PickType edit_pick_type(ObjectType type) {
+    if (type == OBJECT_ENEMY) {
+        return PICK_ENEMY;
+    } else if (type == OBJECT_LIGHT) {
+        return PICK_LIGHT;
+    }
+    return PICK_PLAYER;
+}
+
+bool edit_pick_is_object(const PickItem& item, ObjectSelection* object) {
+    if (item.type == PICK_PLAYER) {
+        *object = { .type = OBJECT_PLAYER, .index = 0 };
+    } else if (item.type == PICK_ENEMY) {
+        *object = { .type = OBJECT_ENEMY, .index = item.index };
+    } else if (item.type == PICK_LIGHT) {
+        *object = { .type = OBJECT_LIGHT, .index = item.index };
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool object_selection_less(const ObjectSelection& a, const ObjectSelection& b) {
+    return a.type < b.type || (a.type == b.type && a.index < b.index);
+}
+
+// handles whose rect might contain the mouse, callers still check each one with is_mouse_in_rect
+void edit_pick_under_mouse(std::vector<PickItem>* results) {
+    // a handle's rect reaches 6 pixels left of and 2 pixels right of where it's drawn, plus a map pixel of truncation either way
+    glm::vec2 min = edit_screen_to_map(glm::vec2(input.mouse_raw_x - 6.0f, input.mouse_raw_y - 6.0f)) - (1.0f / 8.0f);
+    glm::vec2 max = edit_screen_to_map(glm::vec2(input.mouse_raw_x + 2.0f, input.mouse_raw_y + 2.0f)) + (1.0f / 8.0f);
+    pick_query(min, max, results);
+}
+
+bool edit_segment_overlaps_box(glm::vec2 a, glm::vec2 b, glm::vec2 min, glm::vec2 max) {
+    // clip the segment against each side of the box, if anything is left it overlaps
+    glm::vec2 direction = b - a;
+    float p[4] = { -direction.x, direction.x, -direction.y, direction.y };
+    float q[4] = { a.x - min.x, max.x - a.x, a.y - min.y, max.y - a.y };
+    float t_enter = 0.0f;
+    float t_exit = 1.0f;
+    for (unsigned int i = 0; i < 4; i++) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) {
+                return false;
+            }
+            continue;
+        }
+
+        float t = q[i] / p[i];
+        if (p[i] < 0.0f) {
+            t_enter = std::max(t_enter, t);
+        } else {
+            t_exit = std::min(t_exit, t);
+        }
+        if (t_enter > t_exit) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void refresh_ui_boxes() {
+    // every selection change goes through here and selected sectors aren't part of the map layer
+    map_layer_dirty = true;
+
     ui_hover_box.clear();
     if (mode == MODE_SECTOR || mode == MODE_VERTEX || mode == MODE_OBJECT) {
         int lines_of_text = 5;
@@ -107,6 +209,14 @@ void edit_render_sector_walls(const Sector& sector, SDL_Color wall_color, SDL_Co
 void edit_render_sector_vertices(const Sector& sector, SDL_Color vertex_color);
 void edit_render_ui_text(std::string text);
 void edit_render_text(std::string text, int x, int y);
+bool edit_init_glyphs();
+void edit_render_map_layer();
+void edit_box_select();
+void edit_record_drag();
+void edit_begin_sector_height_edit(unsigned int sector);
+void edit_begin_object_height_edit(ObjectSelection object);
+void edit_end_height_edit();
+void edit_apply_undo_change(const UndoChange& change);
 
 bool edit_init() {
     ui_rect = {
@@ -180,11 +290,72 @@ bool edit_init() {
         SDL_FreeSurface(loaded_surface);
     }
 
+    if (!edit_init_glyphs()) {
+        return false;
+    }
+
+    // covers the whole window at map scale, the ui panel is drawn over the part it hides
+    map_layer_size = glm::ivec2((WINDOW_WIDTH + scale - 1) / scale, (WINDOW_HEIGHT + scale - 1) / scale);
+    map_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, map_layer_size.x, map_layer_size.y);
+    if (map_layer == NULL) {
+        printf("Unable to create map layer texture! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(map_layer, SDL_BLENDMODE_NONE);
+
+    pick_build_level();
+
+    return true;
+}
+
+bool edit_init_glyphs() {
+    SDL_Color color = {
+        .r = 255,
+        .g = 255,
+        .b = 255,
+        .a = 255
+    };
+
+    std::string glyphs;
+    for (char c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+        glyphs += c;
+    }
+
+    SDL_Surface* glyph_surface = TTF_RenderText_Solid(font, glyphs.c_str(), color);
+    if (glyph_surface == NULL) {
+        printf("Unable to render glyphs to surface! SDL Error: %s\n", TTF_GetError());
+        return false;
+    }
+
+    glyph_texture = SDL_CreateTextureFromSurface(renderer, glyph_surface);
+    if (glyph_texture == NULL) {
+        printf("Unable to create glyph texture! SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(glyph_surface);
+        return false;
+    }
+
+    // each glyph's rect is found from the width of the glyphs before it, so kerning is accounted for
+    int glyph_x = 0;
+    for (unsigned int i = 0; i < glyphs.length(); i++) {
+        int next_glyph_x;
+        TTF_SizeText(font, glyphs.substr(0, i + 1).c_str(), &next_glyph_x, NULL);
+        glyph_rects[i] = {
+            .x = glyph_x,
+            .y = 0,
+            .w = next_glyph_x - glyph_x,
+            .h = glyph_surface->h
+        };
+        glyph_x = next_glyph_x;
+    }
+
+    SDL_FreeSurface(glyph_surface);
     return true;
 }
 
 void edit_quit() {
     TTF_CloseFont(font);
+    SDL_DestroyTexture(glyph_texture);
+    SDL_DestroyTexture(map_layer);
 
     for (unsigned int i = 0; i < NUM_TEXTURES; i++) {
         SDL_DestroyTexture(textures[i]);
@@ -200,6 +371,20 @@ void edit_quit() {
 void edit_update() {
     ui_hover_index = -1;
 
+    if (!input.is_action_pressed[INPUT_UP] && !input.is_action_pressed[INPUT_DOWN]) {
+        edit_end_height_edit();
+    }
+
+    // undo and redo, but not half way through an edit
+    bool is_editing = dragging || box_selecting || height_edit_sector != -1 || is_editing_object_height || mode == MODE_NEW_SECTOR || mode == MODE_NEW_OBJECT;
+    if (input.is_action_pressed[INPUT_CTRL] && !is_editing && (input.is_action_just_pressed[INPUT_Z] || input.is_action_just_pressed[INPUT_Y])) {
+        UndoChange change;
+        bool has_changed = input.is_action_just_pressed[INPUT_Z] ? undo_undo(&change) : undo_redo(&change);
+        if (has_changed) {
+            edit_apply_undo_change(change);
+        }
+    }
+
     if (input.mouse_raw_x < ui_rect.x) {
         // get mouse coordinate position
         glm::ivec2 mouse_snapped_position = glm::ivec2(input.mouse_raw_x / 4, input.mouse_raw_y / 4) - camera_offset;
@@ -210,36 +395,44 @@ void edit_update() {
         // camera panning
         if (input.is_action_pressed[INPUT_RCLICK]) {
             precise_camera_offset += glm::vec2(input.mouse_raw_xrel / 4.0f, input.mouse_raw_yrel / 4.0f);
-            camera_offset = glm::ivec2(precise_camera_offset);
+            glm::ivec2 new_camera_offset = glm::ivec2(precise_camera_offset);
+            if (new_camera_offset != camera_offset) {
+                camera_offset = new_camera_offset;
+                map_layer_dirty = true;
+            }
         }
 
+        // finish box select
+        if (input.is_action_just_released[INPUT_LCLICK] && box_selecting) {
+            box_selecting = false;
+            edit_box_select();
         // stop dragging object
-        if (input.is_action_just_released[INPUT_LCLICK] && dragging) {
+        } else if (input.is_action_just_released[INPUT_LCLICK] && dragging) {
+            edit_record_drag();
             dragging = false;
             dragging_vertex = -1;
             drag_origin = mouse_snapped_position;
-            level_init_sectors();
         // select object
         } else if (input.is_action_just_released[INPUT_LCLICK] && !dragging) {
             if (mode == MODE_SECTOR) {
                 if (!input.is_action_pressed[INPUT_CTRL]) {
                     selected_sectors.clear();
                 }
-                for (unsigned int i = 0; i < sectors.size(); i++) {
-                    for (unsigned int j = 0; j < sectors[i].vertices.size(); j++) {
-                        SDL_Rect vertex_screen_rect = {
-                            .x = (4 * ((int)(sectors[i].vertices[j].x * 8.0f) + camera_offset.x) - 2),
-                            .y = (4 * ((int)(sectors[i].vertices[j].y * 8.0f) + camera_offset.y) - 2),
-                            .w = 8,
-                            .h = 8
-                        };
-
-                        if (is_mouse_in_rect(vertex_screen_rect)) {
-                            selected_sectors.push_back(i);
-                            break;
-                        }
+                std::vector<PickItem> picked;
+                edit_pick_under_mouse(&picked);
+                std::vector<unsigned int> picked_sectors;
+                for (const PickItem& item : picked) {
+                    if (item.type != PICK_VERTEX) {
+                        continue;
+                    }
+                    SDL_Rect vertex_screen_rect = edit_handle_rect(sectors[item.index].vertices[item.sub_index]);
+                    if (is_mouse_in_rect(vertex_screen_rect)) {
+                        picked_sectors.push_back(item.index);
                     }
                 }
+                std::sort(picked_sectors.begin(), picked_sectors.end());
+                picked_sectors.erase(std::unique(picked_sectors.begin(), picked_sectors.end()), picked_sectors.end());
+                selected_sectors.insert(selected_sectors.end(), picked_sectors.begin(), picked_sectors.end());
                 refresh_ui_boxes();
             } else if (mode == MODE_NEW_SECTOR) {
                 new_sector.add_vertex(glm::vec2(mouse_snapped_position) / 8.0f, current_texture, true);
@@ -247,51 +440,22 @@ void edit_update() {
                 if (!input.is_action_pressed[INPUT_CTRL]) {
                     object_selections.clear();
                 }
-                SDL_Rect p = {
-                    .x = (4 * ((int)(player_spawn_point.x * 8.0f) + camera_offset.x) - 2),
-                    .y = (4 * ((int)(player_spawn_point.z * 8.0f) + camera_offset.y) - 2),
-                    .w = 8,
-                    .h = 8
-                };
-
-                if (is_mouse_in_rect(p)) {
-                    object_selections.push_back({
-                        .type = OBJECT_PLAYER,
-                        .index = 0
-                    });
-                }
-
-                for (unsigned int i = 0; i < enemy_spawns.size(); i++) {
-                    p = {
-                        .x = (4 * ((int)(enemy_spawns[i].position.x * 8.0f) + camera_offset.x) - 2),
-                        .y = (4 * ((int)(enemy_spawns[i].position.z * 8.0f) + camera_offset.y) - 2),
-                        .w = 8,
-                        .h = 8
-                    };
-
-                    if (is_mouse_in_rect(p)) {
-                        object_selections.push_back({
-                            .type = OBJECT_ENEMY,
-                            .index = i
-                        });
+                std::vector<PickItem> picked;
+                edit_pick_under_mouse(&picked);
+                std::vector<ObjectSelection> picked_objects;
+                for (const PickItem& item : picked) {
+                    ObjectSelection object;
+                    if (!edit_pick_is_object(item, &object)) {
+                        continue;
                     }
-                }
-
-                for (unsigned int i = 0; i < lights.size(); i++) {
-                    p = {
-                        .x = (4 * ((int)(lights[i].position.x * 8.0f) + camera_offset.x) - 2),
-                        .y = (4 * ((int)(lights[i].position.z * 8.0f) + camera_offset.y) - 2),
-                        .w = 8,
-                        .h = 8
-                    };
-
+                    glm::vec3 object_position = edit_object_position(object);
+                    SDL_Rect p = edit_handle_rect(glm::vec2(object_position.x, object_position.z));
                     if (is_mouse_in_rect(p)) {
-                        object_selections.push_back({
-                            .type = OBJECT_LIGHT,
-                            .index = i
-                        });
+                        picked_objects.push_back(object);
                     }
                 }
+                std::sort(picked_objects.begin(), picked_objects.end(), object_selection_less);
+                object_selections.insert(object_selections.end(), picked_objects.begin(), picked_objects.end());
 
                 refresh_ui_boxes();
             } else if (mode == MODE_NEW_OBJECT) {
@@ -305,6 +469,8 @@ void edit_update() {
                         .type = OBJECT_ENEMY,
                         .index = (unsigned int)(enemy_spawns.size() - 1)
                     });
+                    undo_record_add_object(object_selections.back());
+                    pick_update_objects();
                     refresh_ui_boxes();
                 } else if (new_object_type == OBJECT_LIGHT) {
                     lights.push_back({
@@ -318,36 +484,49 @@ void edit_update() {
                         .type = OBJECT_LIGHT,
                         .index = (unsigned int)(lights.size() - 1)
                     });
+                    undo_record_add_object(object_selections.back());
+                    pick_update_objects();
                     refresh_ui_boxes();
                 }
             }
         }
 
-        // begin dragging object
+        // begin dragging object, or begin box select when shift is held
         if (input.is_action_just_pressed[INPUT_LCLICK]) {
             drag_origin = mouse_snapped_position;
+            if (input.is_action_pressed[INPUT_YAW_ROLL] && (mode == MODE_SECTOR || mode == MODE_OBJECT)) {
+                box_selecting = true;
+                box_select_origin = glm::ivec2(input.mouse_raw_x, input.mouse_raw_y);
+            }
         }
         // handle dragging object
-        if (input.is_action_pressed[INPUT_LCLICK] && (mouse_snapped_position.x != drag_origin.x || mouse_snapped_position.y != drag_origin.y)) {
+        if (input.is_action_pressed[INPUT_LCLICK] && !box_selecting && (mouse_snapped_position.x != drag_origin.x || mouse_snapped_position.y != drag_origin.y)) {
             dragging = true;
 
             glm::vec2 drag_movement = glm::vec2(mouse_snapped_position - drag_origin) / 8.0f;
             drag_origin = mouse_snapped_position;
 
             if (mode == MODE_VERTEX) {
-                for (unsigned int j = 0; j < sectors[selected_sectors[0]].vertices.size(); j++) {
-                    SDL_Rect vertex_screen_rect = {
-                        .x = (4 * ((int)(sectors[selected_sectors[0]].vertices[j].x * 8.0f) + camera_offset.x) - 2),
-                        .y = (4 * ((int)(sectors[selected_sectors[0]].vertices[j].y * 8.0f) + camera_offset.y) - 2),
-                        .w = 8,
-                        .h = 8
-                    };
-
-                    if (is_mouse_in_rect(vertex_screen_rect)) {
-                        dragging_vertex = j;
-                        break;
+                std::vector<PickItem> picked;
+                edit_pick_under_mouse(&picked);
+                int hovered_vertex = -1;
+                for (const PickItem& item : picked) {
+                    if (item.type != PICK_VERTEX || item.index != selected_sectors[0]) {
+                        continue;
+                    }
+                    SDL_Rect vertex_screen_rect = edit_handle_rect(sectors[item.index].vertices[item.sub_index]);
+                    if (is_mouse_in_rect(vertex_screen_rect) && (hovered_vertex == -1 || (int)item.sub_index < hovered_vertex)) {
+                        hovered_vertex = item.sub_index;
                     }
                 }
+                // the drag can pass over another vertex and carry on with that one, each vertex gets its own undo step
+                if (hovered_vertex != -1 && hovered_vertex != dragging_vertex) {
+                    edit_record_drag();
+                    dragging_vertex = hovered_vertex;
+                }
+            }
+            if (mode != MODE_VERTEX || dragging_vertex != -1) {
+                drag_total_movement += drag_movement;
             }
 
             if (mode == MODE_SECTOR) {
@@ -355,17 +534,22 @@ void edit_update() {
                     for (unsigned int j = 0; j < sectors[sector_index].vertices.size(); j++) {
                         sectors[sector_index].vertices[j] += drag_movement;
                     }
+                    pick_update_sector(sector_index);
                 }
             } else if (mode == MODE_VERTEX && dragging_vertex != -1) {
                 sectors[selected_sectors[0]].vertices[dragging_vertex] += drag_movement;
+                pick_update_sector_vertex(selected_sectors[0], dragging_vertex);
             } else if (mode == MODE_OBJECT) {
                 for (ObjectSelection& object_selection : object_selections) {
                     if (object_selection.type == OBJECT_PLAYER) {
                         player_spawn_point += glm::vec3(drag_movement.x, 0.0f, drag_movement.y);
+                        pick_update_object(PICK_PLAYER, 0);
                     } else if (object_selection.type == OBJECT_ENEMY) {
                         enemy_spawns[object_selection.index].position += glm::vec3(drag_movement.x, 0.0f, drag_movement.y);
+                        pick_update_object(PICK_ENEMY, object_selection.index);
                     } else if (object_selection.type == OBJECT_LIGHT) {
                         lights[object_selection.index].position += glm::vec3(drag_movement.x, 0.0f, drag_movement.y);
+                        pick_update_object(PICK_LIGHT, object_selection.index);
                     }
                 }
             }
@@ -390,7 +574,9 @@ void edit_update() {
             sectors.push_back(new_sector);
             selected_sectors.push_back(sectors.size() - 1);
             mode = MODE_SECTOR;
-            level_init_sectors();
+            undo_record_add_sector(sectors.size() - 1);
+            level_sector_inserted(sectors.size() - 1);
+            pick_update_sector(sectors.size() - 1);
             refresh_ui_boxes();
         }
 
@@ -446,6 +632,10 @@ void edit_update() {
 
         // delete object
         if (mode == MODE_OBJECT && input.is_action_just_pressed[INPUT_DELETE] && ui_hover_index != -1) {
+            edit_end_height_edit();
+            if (object_selections[ui_hover_index].type != OBJECT_PLAYER) {
+                undo_record_delete_object(object_selections[ui_hover_index]);
+            }
             if (object_selections[ui_hover_index].type == OBJECT_ENEMY) {
                 enemy_spawns.erase(enemy_spawns.begin() + object_selections[ui_hover_index].index);
                 object_selections.erase(object_selections.begin() + ui_hover_index);
@@ -453,6 +643,7 @@ void edit_update() {
                 lights.erase(lights.begin() + object_selections[ui_hover_index].index);
                 object_selections.erase(object_selections.begin() + ui_hover_index);
             }
+            pick_update_objects();
             refresh_ui_boxes();
         }
 
@@ -492,41 +683,47 @@ void edit_update() {
 
         // begin changing ceiling
         if (mode == MODE_SECTOR && input.is_action_pressed[INPUT_UP] && ui_hover_index != -1 && input.mouse_raw_yrel != 0) {
+            edit_begin_sector_height_edit(selected_sectors[ui_hover_index]);
             sectors[selected_sectors[ui_hover_index]].ceiling_y -= input.mouse_raw_yrel;
             if (sectors[selected_sectors[ui_hover_index]].ceiling_y <= sectors[selected_sectors[ui_hover_index]].floor_y) {
                 sectors[selected_sectors[ui_hover_index]].ceiling_y = sectors[selected_sectors[ui_hover_index]].floor_y + 1;
             }
-            changing_floor_or_ceiling = true;
         }
 
         // begin changing floor
         if (mode == MODE_SECTOR && input.is_action_pressed[INPUT_DOWN] && ui_hover_index != -1 && input.mouse_raw_yrel != 0) {
+            edit_begin_sector_height_edit(selected_sectors[ui_hover_index]);
             sectors[selected_sectors[ui_hover_index]].floor_y -= input.mouse_raw_yrel;
             if (sectors[selected_sectors[ui_hover_index]].floor_y >= sectors[selected_sectors[ui_hover_index]].ceiling_y) {
                 sectors[selected_sectors[ui_hover_index]].floor_y = sectors[selected_sectors[ui_hover_index]].ceiling_y - 1;
             }
-            changing_floor_or_ceiling = true;
-        }
-
-        // end changing ceiling or floor
-        if (mode == MODE_SECTOR && (input.is_action_just_released[INPUT_UP] || input.is_action_just_released[INPUT_DOWN]) && changing_floor_or_ceiling) {
-            changing_floor_or_ceiling = false;
-            level_init_sectors();
         }
 
         // delete sector
         if (mode == MODE_SECTOR && input.is_action_just_pressed[INPUT_DELETE] && ui_hover_index != -1) {
-            sectors.erase(sectors.begin() + selected_sectors[ui_hover_index]);
+            edit_end_height_edit();
+            unsigned int deleted_sector = selected_sectors[ui_hover_index];
+            undo_record_delete_sector(deleted_sector);
+            sectors.erase(sectors.begin() + deleted_sector);
             selected_sectors.erase(selected_sectors.begin() + ui_hover_index);
             ui_hover_index = -1;
-            level_init_sectors();
+            level_sector_erased(deleted_sector);
+            // every sector after the deleted one changed index
+            for (unsigned int& selected_sector : selected_sectors) {
+                if (selected_sector > deleted_sector) {
+                    selected_sector--;
+                }
+            }
+            pick_build_level();
             refresh_ui_boxes();
         }
 
         // toggle wall hidden
         if (mode == MODE_VERTEX && input.is_action_just_pressed[INPUT_FORWARD] && ui_hover_index != -1) {
+            Wall before = sectors[selected_sectors[0]].walls[ui_hover_index];
             sectors[selected_sectors[0]].walls[ui_hover_index].exists = !sectors[selected_sectors[0]].walls[ui_hover_index].exists;
-            level_init_sectors();
+            undo_record_wall(selected_sectors[0], ui_hover_index, before);
+            level_init_sector(selected_sectors[0]);
         }
 
         // change current texture
@@ -540,24 +737,31 @@ void edit_update() {
 
         // set wall texture
         if (mode == MODE_VERTEX && ui_hover_index != -1 && input.is_action_just_pressed[INPUT_T]) {
+            Wall before = sectors[selected_sectors[0]].walls[ui_hover_index];
             sectors[selected_sectors[0]].walls[ui_hover_index].texture_index = current_texture;
-            level_init_sectors();
+            undo_record_wall(selected_sectors[0], ui_hover_index, before);
+            level_init_sector(selected_sectors[0]);
         }
 
         // set ceiling texture
         if (mode == MODE_SECTOR && ui_hover_index != -1 && input.is_action_just_pressed[INPUT_T]) {
+            SectorProperties before = sector_properties(sectors[selected_sectors[ui_hover_index]]);
             sectors[selected_sectors[ui_hover_index]].ceiling_texture_index = current_texture;
-            level_init_sectors();
+            undo_record_sector_properties(selected_sectors[ui_hover_index], before);
+            level_init_sector(selected_sectors[ui_hover_index]);
         }
 
         // set floor texture
         if (mode == MODE_SECTOR && ui_hover_index != -1 && input.is_action_just_pressed[INPUT_G]) {
+            SectorProperties before = sector_properties(sectors[selected_sectors[ui_hover_index]]);
             sectors[selected_sectors[ui_hover_index]].floor_texture_index = current_texture;
-            level_init_sectors();
+            undo_record_sector_properties(selected_sectors[ui_hover_index], before);
+            level_init_sector(selected_sectors[ui_hover_index]);
         }
 
         // begin changing object y
         if (mode == MODE_OBJECT && ui_hover_index != -1 && input.is_action_pressed[INPUT_UP]) {
+            edit_begin_object_height_edit(object_selections[ui_hover_index]);
             if (object_selections[ui_hover_index].type == OBJECT_PLAYER) {
                 player_spawn_point.y -= input.mouse_raw_yrel * 0.5f;
             } else if (object_selections[ui_hover_index].type == OBJECT_ENEMY) {
@@ -580,6 +784,7 @@ void edit_update() {
                 if (enemy_spawns[object_selections[ui_hover_index].index].direction == directions[direction_index]) {
                     unsigned int new_direction_index = (direction_index + 1) % 4;
                     enemy_spawns[object_selections[ui_hover_index].index].direction = directions[new_direction_index];
+                    undo_record_turn_enemy(object_selections[ui_hover_index].index, directions[direction_index]);
                     break;
                 }
             }
@@ -587,12 +792,182 @@ void edit_update() {
     }
 }
 
-void edit_render() {
+void edit_record_drag() {
+    if (drag_total_movement == glm::vec2(0.0f)) {
+        return;
+    }
+
+    if (mode == MODE_SECTOR && !selected_sectors.empty()) {
+        undo_record_move_sectors(selected_sectors, drag_total_movement);
+        for (unsigned int sector_index : selected_sectors) {
+            level_init_sector(sector_index);
+        }
+    } else if (mode == MODE_VERTEX && dragging_vertex != -1) {
+        undo_record_move_vertex(selected_sectors[0], dragging_vertex, drag_total_movement);
+        level_init_sector(selected_sectors[0]);
+    } else if (mode == MODE_OBJECT && !object_selections.empty()) {
+        undo_record_move_objects(object_selections, glm::vec3(drag_total_movement.x, 0.0f, drag_total_movement.y));
+    }
+    drag_total_movement = glm::vec2(0.0f);
+}
+
+void edit_begin_sector_height_edit(unsigned int sector) {
+    if (height_edit_sector == (int)sector) {
+        return;
+    }
+
+    edit_end_height_edit();
+    height_edit_sector = sector;
+    height_edit_before = sector_properties(sectors[sector]);
+}
+
+void edit_begin_object_height_edit(ObjectSelection object) {
+    if (is_editing_object_height && height_edit_object.type == object.type && height_edit_object.index == object.index) {
+        return;
+    }
+
+    edit_end_height_edit();
+    is_editing_object_height = true;
+    height_edit_object = object;
+    height_edit_object_y = edit_object_position(object).y;
+}
+
+void edit_end_height_edit() {
+    if (height_edit_sector != -1) {
+        SectorProperties after = sector_properties(sectors[height_edit_sector]);
+        if (after.floor_y != height_edit_before.floor_y || after.ceiling_y != height_edit_before.ceiling_y) {
+            undo_record_sector_properties(height_edit_sector, height_edit_before);
+            level_init_sector(height_edit_sector);
+        }
+        height_edit_sector = -1;
+    }
+
+    if (is_editing_object_height) {
+        float object_y = edit_object_position(height_edit_object).y;
+        if (object_y != height_edit_object_y) {
+            undo_record_move_objects(std::vector<ObjectSelection>(1, height_edit_object), glm::vec3(0.0f, object_y - height_edit_object_y, 0.0f));
+        }
+        is_editing_object_height = false;
+    }
+}
+
+void edit_apply_undo_change(const UndoChange& change) {
+    if (change.erased_sector != -1) {
+        level_sector_erased(change.erased_sector);
+    }
+    if (change.inserted_sector != -1) {
+        level_sector_inserted(change.inserted_sector);
+    }
+    for (unsigned int sector_index : change.sectors) {
+        if ((int)sector_index != change.inserted_sector) {
+            level_init_sector(sector_index);
+        }
+    }
+
+    // inserting or erasing a sector changes the index of every sector after it
+    if (change.inserted_sector != -1 || change.erased_sector != -1) {
+        pick_build_level();
+    } else {
+        for (unsigned int sector_index : change.sectors) {
+            pick_update_sector(sector_index);
+        }
+    }
+    if (change.objects_reindexed) {
+        pick_update_objects();
+    } else {
+        for (const ObjectSelection& object : change.objects) {
+            pick_update_object(edit_pick_type(object.type), object.index);
+        }
+    }
+
+    // select whatever changed so that it's clear what was undone
+    selected_sectors.clear();
+    object_selections.clear();
+    if (change.vertex_sector != -1) {
+        mode = MODE_VERTEX;
+        selected_sectors.push_back(change.vertex_sector);
+    } else if (!change.objects.empty() || change.objects_reindexed) {
+        mode = MODE_OBJECT;
+        object_selections = change.objects;
+    } else {
+        mode = MODE_SECTOR;
+        selected_sectors = change.sectors;
+    }
+    refresh_ui_boxes();
+}
+
+void edit_box_select() {
+    glm::vec2 corner_a = edit_screen_to_map(glm::vec2(box_select_origin));
+    glm::vec2 corner_b = edit_screen_to_map(glm::vec2(input.mouse_raw_x, input.mouse_raw_y));
+    glm::vec2 box_min = glm::min(corner_a, corner_b);
+    glm::vec2 box_max = glm::max(corner_a, corner_b);
+
+    std::vector<PickItem> picked;
+    pick_query(box_min, box_max, &picked);
+
+    if (mode == MODE_SECTOR) {
+        if (!input.is_action_pressed[INPUT_CTRL]) {
+            selected_sectors.clear();
+        }
+
+        // a sector is selected when any of its walls touch the box
+        std::vector<unsigned int> picked_sectors;
+        for (const PickItem& item : picked) {
+            if (item.type != PICK_WALL) {
+                continue;
+            }
+            const Sector& sector = sectors[item.index];
+            glm::vec2 a = sector.vertices[item.sub_index];
+            glm::vec2 b = sector.vertices[(item.sub_index + 1) % sector.vertices.size()];
+            if (edit_segment_overlaps_box(a, b, box_min, box_max)) {
+                picked_sectors.push_back(item.index);
+            }
+        }
+        std::sort(picked_sectors.begin(), picked_sectors.end());
+        picked_sectors.erase(std::unique(picked_sectors.begin(), picked_sectors.end()), picked_sectors.end());
+        for (unsigned int sector_index : picked_sectors) {
+            if (std::find(selected_sectors.begin(), selected_sectors.end(), sector_index) == selected_sectors.end()) {
+                selected_sectors.push_back(sector_index);
+            }
+        }
+    } else if (mode == MODE_OBJECT) {
+        if (!input.is_action_pressed[INPUT_CTRL]) {
+            object_selections.clear();
+        }
+
+        std::vector<ObjectSelection> picked_objects;
+        for (const PickItem& item : picked) {
+            ObjectSelection object;
+            if (edit_pick_is_object(item, &object)) {
+                picked_objects.push_back(object);
+            }
+        }
+        std::sort(picked_objects.begin(), picked_objects.end(), object_selection_less);
+        for (const ObjectSelection& object : picked_objects) {
+            bool is_selected = false;
+            for (const ObjectSelection& object_selection : object_selections) {
+                is_selected = is_selected || (object_selection.type == object.type && object_selection.index == object.index);
+            }
+            if (!is_selected) {
+                object_selections.push_back(object);
+            }
+        }
+    }
+
+    refresh_ui_boxes();
+}
+
+void edit_request_redraw() {
+    needs_redraw = true;
+}
+
+void edit_render_map_layer() {
+    SDL_SetRenderTarget(renderer, map_layer);
+    SDL_RenderSetScale(renderer, 1, 1);
+
     SDL_SetRenderDrawColor(renderer, 5, 61, 125, 255);
     SDL_RenderClear(renderer);
 
-    SDL_RenderSetScale(renderer, scale, scale);
-
     // draw gridlines
     // SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_SetRenderDrawColor(renderer, 31, 42, 42, 255);
@@ -627,6 +1002,32 @@ void edit_render() {
         edit_render_sector_vertices(sectors[i], vertex_color);
     }
 
+    SDL_SetRenderTarget(renderer, NULL);
+    map_layer_dirty = false;
+}
+
+void edit_render() {
+    // nothing the editor shows can change without an event coming in first
+    if (!needs_redraw) {
+        return;
+    }
+    needs_redraw = false;
+
+    if (map_layer_dirty) {
+        edit_render_map_layer();
+    }
+
+    SDL_RenderSetScale(renderer, 1, 1);
+    SDL_Rect map_layer_rect = {
+        .x = 0,
+        .y = 0,
+        .w = map_layer_size.x * (int)scale,
+        .h = map_layer_size.y * (int)scale
+    };
+    SDL_RenderCopy(renderer, map_layer, NULL, &map_layer_rect);
+
+    SDL_RenderSetScale(renderer, scale, scale);
+
     if (mode == MODE_SECTOR || mode == MODE_VERTEX) {
         // selected sector walls
         for (unsigned int selected_sector : selected_sectors) {
@@ -705,6 +1106,16 @@ void edit_render() {
 
     // Render UI
     SDL_RenderSetScale(renderer, 1, 1);
+    if (box_selecting) {
+        SDL_SetRenderDrawColor(renderer, vertex_cursor_color.r, vertex_cursor_color.g, vertex_cursor_color.b, vertex_cursor_color.a);
+        SDL_Rect box_select_rect = {
+            .x = std::min(box_select_origin.x, (int)input.mouse_raw_x),
+            .y = std::min(box_select_origin.y, (int)input.mouse_raw_y),
+            .w = std::abs((int)input.mouse_raw_x - box_select_origin.x),
+            .h = std::abs((int)input.mouse_raw_y - box_select_origin.y)
+        };
+        SDL_RenderDrawRect(renderer, &box_select_rect);
+    }
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderFillRect(renderer, &ui_rect);
 
@@ -825,32 +1236,22 @@ void edit_render_ui_text(std::string text) {
 }
 
 void edit_render_text(std::string text, int x, int y) {
-    SDL_Color color = {
-        .r = 255,
-        .g = 255,
-        .b = 255,
-        .a = 255
-    };
-
-    SDL_Surface* text_surface = TTF_RenderText_Solid(font, text.c_str(), color);
-    if(text_surface == NULL){
-
-        printf("Unable to render text to surface! SDL Error: %s\n", TTF_GetError());
+    // long selections list far more text than fits in the window
+    if (y >= (int)WINDOW_HEIGHT) {
         return;
     }
 
-    SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-
-    if(text_texture == NULL){
+    SDL_Rect dest_rect = (SDL_Rect){ .x = x, .y = y, .w = 0, .h = 0 };
+    for (unsigned int i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+            c = '?';
+        }
 
-        printf("Unable to reate texture! SDL Error: %s\n", SDL_GetError());
-        return;
+        const SDL_Rect& source_rect = glyph_rects[c - FIRST_GLYPH];
+        dest_rect.w = source_rect.w;
+        dest_rect.h = source_rect.h;
+        SDL_RenderCopy(renderer, glyph_texture, &source_rect, &dest_rect);
+        dest_rect.x += source_rect.w;
     }
-
-    SDL_Rect source_rect = (SDL_Rect){ .x = 0, .y = 0, .w = text_surface->w, .h = text_surface->h };
-    SDL_Rect dest_rect = (SDL_Rect){ .x = x, .y = y, .w = text_surface->w, .h = text_surface->h };
-    SDL_RenderCopy(renderer, text_texture, &source_rect, &dest_rect);
-
-    SDL_FreeSurface(text_surface);
-    SDL_DestroyTexture(text_texture);
 }
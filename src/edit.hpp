@@ -1,6 +1,19 @@
 #pragma once
 
+enum ObjectType {
+    OBJECT_PLAYER,
+    OBJECT_ENEMY,
+    OBJECT_LIGHT
+};
+
+struct ObjectSelection {
+    ObjectType type;
+    unsigned int index;
+};
+
 bool edit_init();
 void edit_quit();
 void edit_update();
 void edit_render();
+// edit_render skips frames where nothing happened, call this when the window needs repainting anyway
+void edit_request_redraw();
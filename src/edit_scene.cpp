@@ -5,6 +5,7 @@
 #include "level.hpp"
 #include "globals.hpp"
 #include "input.hpp"
+#include "undo.hpp"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -16,18 +17,29 @@ float camera_pitch = 0.0f;
 glm::vec3 camera_direction = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 camera_position = glm::vec3(0.0f, 0.5f, 0.0f);
 
-bool lighting_enabled = true;
+// starts out off like the texture shader's uniform, which level_init_lighting sets to !edit_mode
+bool lighting_enabled = false;
+// the level as it was when the lightmap was last baked
+uint64_t edit_scene_lighting_hash = 0;
+bool edit_scene_wasp_acquired = false;
+
+void edit_scene_resources(std::vector<ResourceHandle>* handles) {
+    handles->push_back(resource_textures);
+    if (!enemy_spawns.empty()) {
+        handles->push_back(resource_wasp);
+    }
+}
 
 void edit_scene_init() {
     glm::ivec2 screen_size = glm::ivec2(SCREEN_WIDTH, SCREEN_HEIGHT);
     glUseProgram(billboard_shader);
-    glUniform1i(glGetUniformLocation(billboard_shader, "u_texture_array"), 0);
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), 0);
+    glUniform1i(glGetUniformLocation(billboard_shader, "u_texture"), 0);
     glUniform2iv(glGetUniformLocation(billboard_shader, "screen_size"), 1, glm::value_ptr(screen_size));
     glUseProgram(ui_shader);
     glUniform2iv(glGetUniformLocation(ui_shader, "screen_size"), 1, glm::value_ptr(screen_size));
 
     camera_position = glm::vec3(0.0f, 1.0f, 0.0f);
+    resource_acquire(resource_textures);
 }
 
 void edit_scene_update(float delta) {
@@ -69,11 +81,28 @@ void edit_scene_update(float delta) {
         lighting_enabled = !lighting_enabled;
         glUseProgram(billboard_shader);
         glUniform1ui(glGetUniformLocation(billboard_shader, "lighting_enabled"), lighting_enabled);
-        glUseProgram(texture_shader);
-        glUniform1ui(glGetUniformLocation(texture_shader, "lighting_enabled"), lighting_enabled);
     }
 }
 
+// edits from either editor mode rebuild sectors with lightmap coordinates that aren't in the atlas, so a changed level is baked again before it's drawn lit
+// not in the middle of a drag though, a bake can take long enough on a big level that it would stutter every frame, so until then the level is drawn unlit
+bool edit_scene_update_lighting() {
+    if (!lighting_enabled) {
+        return false;
+    }
+
+    uint64_t level_hash = undo_level_hash();
+    if (level_hash == edit_scene_lighting_hash) {
+        return true;
+    }
+    if (input.is_action_pressed[INPUT_LCLICK] || input.is_action_pressed[INPUT_RCLICK]) {
+        return false;
+    }
+    level_init_sectors();
+    edit_scene_lighting_hash = level_hash;
+    return true;
+}
+
 void edit_scene_render() {
     glm::mat4 view;
     view = glm::lookAt(camera_position, camera_position + camera_direction, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -88,19 +117,36 @@ void edit_scene_render() {
     glUniform3fv(glGetUniformLocation(billboard_shader, "view_pos"), 1, glm::value_ptr(camera_position));
     glUniform3fv(glGetUniformLocation(billboard_shader, "player_flashlight.position"), 1, glm::value_ptr(camera_position));
     glUniform3fv(glGetUniformLocation(billboard_shader, "player_flashlight.direction"), 1, glm::value_ptr(camera_direction));
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), 0);
     glUniform1ui(glGetUniformLocation(billboard_shader, "flip_h"), false);
 
+    glUseProgram(texture_shader);
+    glUniform1ui(glGetUniformLocation(texture_shader, "lighting_enabled"), edit_scene_update_lighting());
     level_render(view, projection, camera_position, glm::vec3(0.0f), false);
 
-    glUniform2iv(glGetUniformLocation(billboard_shader, "extents"), 1, glm::value_ptr(resource_extents[resource_wasp]));
+    // the wasp sprite marks enemy spawns, so it's only held while the level has any
+    bool has_enemy_spawns = !enemy_spawns.empty();
+    if (has_enemy_spawns && !edit_scene_wasp_acquired) {
+        resource_acquire(resource_wasp);
+    } else if (!has_enemy_spawns && edit_scene_wasp_acquired) {
+        resource_release(resource_wasp);
+    }
+    edit_scene_wasp_acquired = has_enemy_spawns;
+    if (!has_enemy_spawns) {
+        return;
+    }
+
+    resource_bind_sprite(resource_wasp, 0);
+    float enemy_radius = level_billboard_radius(resource_info(resource_wasp).extents);
     for (EnemySpawn& enemy_spawn : enemy_spawns) {
+        if (!level_is_billboard_visible(enemy_spawn.position, enemy_radius, -1)) {
+            continue;
+        }
+
         glm::vec3 facing_direction = glm::normalize(glm::vec3(camera_position.x, enemy_spawn.position.y, camera_position.z) - enemy_spawn.position);
         glm::mat4 model = glm::inverse(glm::lookAt(enemy_spawn.position, enemy_spawn.position + facing_direction, glm::vec3(0.0f, 1.0f, 0.0f)));
         glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
         glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(facing_direction));
 
-        glBindTexture(GL_TEXTURE_2D_ARRAY, resource_wasp);
         glBindVertexArray(quad_vao);
         glDrawArrays(GL_TRIANGLES, 0, 6);
     }
@@ -1,5 +1,11 @@
 #pragma once
 
+#include "resource.hpp"
+
+#include <vector>
+
+// the textures the editor preview of the loaded level uses
+void edit_scene_resources(std::vector<ResourceHandle>* handles);
 void edit_scene_init();
 void edit_scene_update(float delta);
 void edit_scene_render();
@@ -1,13 +1,14 @@
 #include "enemy.hpp"
 
 #include "raycast.hpp"
+#include "level.hpp"
 #include "resource.hpp"
-#include "shader.hpp"
 #include "globals.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "arena.hpp"
 
-#include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
 std::vector<Enemy> enemies;
 
@@ -37,28 +38,29 @@ void EnemyBulletHole::update(float delta) {
     animation.update(delta);
 }
 
-void EnemyBulletHole::render() {
+void EnemyBulletHole::capture(glm::vec3 offset, std::vector<Billboard>* billboards) const {
     if (animation.is_finished) {
         return;
     }
 
-    glUniform2iv(glGetUniformLocation(billboard_shader, "extents"), 1, glm::value_ptr(resource_extents[resource_wasp_bullet_hole]));
-    glm::mat4 model = glm::inverse(glm::lookAt(position, position + normal, glm::vec3(0.0f, 1.0f, 0.0f)));
-    glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(normal));
-    glUniform1ui(glGetUniformLocation(billboard_shader, "flip_h"), false);
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), animation.frame);
-
-    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_wasp_bullet_hole);
-    glBindVertexArray(quad_vao);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glm::vec3 render_position = position + offset;
+    billboards->push_back({
+        .sprite = resource_wasp_bullet_hole,
+        .frame = animation.frame,
+        .model = glm::inverse(glm::lookAt(render_position, render_position + normal, glm::vec3(0.0f, 1.0f, 0.0f))),
+        .normal = normal,
+        .flip_h = false
+    });
 }
 
 Enemy::Enemy(unsigned int id) {
     position = glm::vec3(0.0f, 1.0f, -1.0f);
     direction = glm::vec3(0.0f, 0.0f, 1.0f);
     facing_direction = direction;
+    previous_position = position;
+    previous_facing_direction = facing_direction;
     angle = 0.0f;
+    sector = -1;
 
     animation.add_animation(ENEMY_ANIMATION_IDLE, {
         .start_frame = 0,
@@ -99,9 +101,13 @@ Enemy::Enemy(unsigned int id) {
 }
 
 void Enemy::update(glm::vec3 player_position, float delta) {
+    ProfileScope profile_scope("Enemy::update");
+    previous_position = position;
+    previous_facing_direction = facing_direction;
     if (is_dead) {
         return;
     }
+    stats_add(STAT_ENEMIES_UPDATED, 1);
 
     glm::vec3 velocity = glm::vec3(0.0f, 0.0f, 0.0f);
     hit_player = false;
@@ -185,6 +191,7 @@ void Enemy::update(glm::vec3 player_position, float delta) {
         // movement
         position += velocity;
     }
+    sector = level_find_sector(position);
 
     // update animation
     animation.update(delta);
@@ -199,15 +206,21 @@ void Enemy::update(glm::vec3 player_position, float delta) {
         has_hit = false;
     }
 
-    // update bullet holes
-    std::vector<unsigned int> indices_to_remove;
-    for (EnemyBulletHole& bullet_hole : bullet_holes) {
-        bullet_hole.position += velocity;
-        bullet_hole.update(delta);
+    // update bullet holes, finished ones aren't drawn anymore
+    FrameVector<unsigned int> indices_to_remove;
+    for (unsigned int i = 0; i < bullet_holes.size(); i++) {
+        bullet_holes[i].position += velocity;
+        bullet_holes[i].update(delta);
+        if (bullet_holes[i].animation.is_finished) {
+            indices_to_remove.push_back(i);
+        }
     }
-    for (unsigned int index: indices_to_remove) {
-        bullet_holes.erase(bullet_holes.begin() + index);
+    // back to front, so erasing doesn't move the holes still to be erased
+    for (unsigned int i = indices_to_remove.size(); i > 0; i--) {
+        bullet_holes.erase(bullet_holes.begin() + indices_to_remove[i - 1]);
     }
+
+    update_hurtbox();
 }
 
 void Enemy::take_damage(RaycastResult& result, int amount) {
@@ -219,49 +232,65 @@ void Enemy::take_damage(RaycastResult& result, int amount) {
     if (health <= 0) {
         animation.set_animation(ENEMY_ANIMATION_DIE);
     } else {
+        if (bullet_holes.size() == ENEMY_MAX_BULLET_HOLES) {
+            bullet_holes.erase(bullet_holes.begin());
+        }
         bullet_holes.push_back(EnemyBulletHole(result.point + (raycast_planes[hurtbox_raycast_plane].normal * 0.05f), raycast_planes[hurtbox_raycast_plane].normal));
     }
 }
 
-void Enemy::render() {
+glm::mat4 enemy_model(glm::vec3 position, glm::vec3 facing_direction) {
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    if (std::abs(glm::dot(up, facing_direction)) == 1.0f) {
+        up = glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+    return glm::inverse(glm::lookAt(position, position + facing_direction, up));
+}
+
+void Enemy::update_hurtbox() {
+    // the hurtbox follows the simulation and not what's rendered, so hits don't depend on the frame rate
+    glm::mat4 model = enemy_model(position, facing_direction);
+    raycast_planes[hurtbox_raycast_plane].a = glm::vec3(model * glm::vec4(-hurtbox_extents.x, -hurtbox_extents.y, 0.0f, 1.0f));
+    raycast_planes[hurtbox_raycast_plane].b = glm::vec3(model * glm::vec4(hurtbox_extents.x, -hurtbox_extents.y, 0.0f, 1.0f));
+    raycast_planes[hurtbox_raycast_plane].c = glm::vec3(model * glm::vec4(hurtbox_extents.x, hurtbox_extents.y, 0.0f, 1.0f));
+    raycast_planes[hurtbox_raycast_plane].d = glm::vec3(model * glm::vec4(-hurtbox_extents.x, hurtbox_extents.y, 0.0f, 1.0f));
+    raycast_planes[hurtbox_raycast_plane].normal = facing_direction;
+}
+
+void Enemy::capture(float interpolation, std::vector<Billboard>* billboards) {
     if (is_dead) {
         return;
     }
 
-    glUniform2iv(glGetUniformLocation(billboard_shader, "extents"), 1, glm::value_ptr(resource_extents[resource_wasp]));
+    glm::vec3 render_position = glm::mix(previous_position, position, interpolation);
+    glm::vec3 render_facing_direction = glm::mix(previous_facing_direction, facing_direction, interpolation);
+    if (glm::length(render_facing_direction) < 0.001f) {
+        render_facing_direction = facing_direction;
+    }
+    render_facing_direction = glm::normalize(render_facing_direction);
 
-    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-    if (std::abs(glm::dot(up, facing_direction)) == 1.0f) {
-        up = glm::vec3(0.0f, 0.0f, 1.0f);
+    // bullet holes are stuck to the enemy, so they get culled along with it
+    if (!level_is_billboard_visible(render_position, level_billboard_radius(resource_info(resource_wasp).extents), sector)) {
+        return;
     }
-    glm::mat4 model = glm::inverse(glm::lookAt(position, position + facing_direction, up));
-    glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(facing_direction));
 
     animation_offset = (unsigned int)(abs(angle) / 36.0f);
     flip_h = angle < 0.0f && animation_offset >= 1 && animation_offset <= 3;
 
-    glUniform1ui(glGetUniformLocation(billboard_shader, "flip_h"), flip_h);
-
     unsigned int animation_frame = animation.frame;
     if (animation.animation == ENEMY_ANIMATION_IDLE) {
         animation_frame += animation_offset * 3;
     }
 
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), animation_frame);
-
-    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_wasp);
-    glBindVertexArray(quad_vao);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    // update hurtbox plane
-    raycast_planes[hurtbox_raycast_plane].a = glm::vec3(model * glm::vec4(-hurtbox_extents.x, -hurtbox_extents.y, 0.0f, 1.0f));
-    raycast_planes[hurtbox_raycast_plane].b = glm::vec3(model * glm::vec4(hurtbox_extents.x, -hurtbox_extents.y, 0.0f, 1.0f));
-    raycast_planes[hurtbox_raycast_plane].c = glm::vec3(model * glm::vec4(hurtbox_extents.x, hurtbox_extents.y, 0.0f, 1.0f));
-    raycast_planes[hurtbox_raycast_plane].d = glm::vec3(model * glm::vec4(-hurtbox_extents.x, hurtbox_extents.y, 0.0f, 1.0f));
-    raycast_planes[hurtbox_raycast_plane].normal = facing_direction;
+    billboards->push_back({
+        .sprite = resource_wasp,
+        .frame = animation_frame,
+        .model = enemy_model(render_position, render_facing_direction),
+        .normal = render_facing_direction,
+        .flip_h = flip_h
+    });
 
-    for (EnemyBulletHole& bullet_hole : bullet_holes) {
-        bullet_hole.render();
+    for (const EnemyBulletHole& bullet_hole : bullet_holes) {
+        bullet_hole.capture(render_position - position, billboards);
     }
 }
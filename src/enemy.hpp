@@ -2,10 +2,14 @@
 
 #include "animation.hpp"
 #include "raycast.hpp"
+#include "billboard.hpp"
 
 #include <glm/glm.hpp>
 #include <vector>
 
+// holes are gone once their animation finishes, this many at once is more than the fire rate allows
+const unsigned int ENEMY_MAX_BULLET_HOLES = 8;
+
 struct EnemyBulletHole {
     glm::vec3 position;
     glm::vec3 normal;
@@ -13,14 +17,18 @@ struct EnemyBulletHole {
 
     EnemyBulletHole(glm::vec3 position, glm::vec3 normal);
     void update(float delta);
-    void render();
+    void capture(glm::vec3 offset, std::vector<Billboard>* billboards) const;
 };
 
 struct Enemy {
     glm::vec3 position;
     glm::vec3 direction;
     glm::vec3 facing_direction;
+    // the state at the start of the last tick, rendering interpolates from it
+    glm::vec3 previous_position;
+    glm::vec3 previous_facing_direction;
     float angle;
+    int sector;
 
     std::vector<EnemyBulletHole> bullet_holes;
 
@@ -41,7 +49,9 @@ struct Enemy {
     Enemy(unsigned int id);
     void update(glm::vec3 player_position, float delta);
     void take_damage(RaycastResult& result, int amount);
-    void render();
+    void update_hurtbox();
+    // records the enemy's sprite and bullet holes for the frame, culled ones are skipped
+    void capture(float interpolation, std::vector<Billboard>* billboards);
 };
 
 extern std::vector<Enemy> enemies;
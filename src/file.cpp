@@ -0,0 +1,206 @@
+#include "file.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <direct.h>
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+    data = NULL;
+    size = 0;
+}
+
+bool file_map(const std::string& path, MappedFile* file) {
+#ifdef _WIN32
+    if (!file_read(path, &file->buffer)) {
+        return false;
+    }
+    file->data = file->buffer.empty() ? NULL : &file->buffer[0];
+    file->size = file->buffer.size();
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file, so the descriptor isn't needed anymore
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    file->data = (const unsigned char*)data;
+    file->size = file_stat.st_size;
+    return true;
+#endif
+}
+
+void file_unmap(MappedFile* file) {
+#ifdef _WIN32
+    file->buffer.clear();
+    file->buffer.shrink_to_fit();
+#else
+    if (file->data != NULL) {
+        munmap((void*)file->data, file->size);
+    }
+#endif
+    file->data = NULL;
+    file->size = 0;
+}
+
+bool file_read(const std::string& path, std::vector<unsigned char>* data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data->resize(size);
+    if (size > 0 && !file.read((char*)&(*data)[0], size)) {
+        return false;
+    }
+
+    return true;
+}
+
+bool file_write_atomic(const std::string& path, const std::vector<unsigned char>& data) {
+    // write next to the destination and rename over it so that readers never see a half written file
+    std::string temp_path = path + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write((const char*)&data[0], data.size());
+    file.close();
+    if (file.fail()) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    // rename doesn't replace existing files on windows
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool file_make_directory(const std::string& path) {
+#ifdef _WIN32
+    return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+    struct stat dir_stat;
+    if (stat(path.c_str(), &dir_stat) == 0) {
+        return S_ISDIR(dir_stat.st_mode);
+    }
+    // another thread may have created it since the stat
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+bool file_stat(const std::string& path, uint64_t* size, int64_t* modified_time) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes) || (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    *size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    // file times count 100 nanosecond intervals from 1601
+    uint64_t write_time = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    *modified_time = (int64_t)(write_time / 10000000ULL) - 11644473600LL;
+    return true;
+#else
+    struct stat path_stat;
+    if (stat(path.c_str(), &path_stat) != 0 || !S_ISREG(path_stat.st_mode)) {
+        return false;
+    }
+    *size = path_stat.st_size;
+    *modified_time = path_stat.st_mtime;
+    return true;
+#endif
+}
+
+bool file_list(const std::string& path, std::vector<std::string>* paths) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        return false;
+    }
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        paths->push_back(path);
+        return true;
+    }
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA((path + "/*").c_str(), &find_data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    bool success = true;
+    do {
+        std::string name = find_data.cFileName;
+        if (name != "." && name != "..") {
+            success = file_list(path + "/" + name, paths) && success;
+        }
+    } while (FindNextFileA(find, &find_data));
+    FindClose(find);
+    return success;
+#else
+    struct stat path_stat;
+    if (stat(path.c_str(), &path_stat) != 0) {
+        return false;
+    }
+    if (!S_ISDIR(path_stat.st_mode)) {
+        paths->push_back(path);
+        return true;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL) {
+        return false;
+    }
+    bool success = true;
+    for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            success = file_list(path + "/" + name, paths) && success;
+        }
+    }
+    closedir(dir);
+    return success;
+#endif
+}
+
+uint64_t file_hash(const void* data, size_t size, uint64_t hash) {
+    // FNV-1a
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint64_t FILE_HASH_SEED = 14695981039346656037ULL;
+
+struct MappedFile {
+    const unsigned char* data;
+    size_t size;
+    // platforms without mmap read the whole file into this instead
+    std::vector<unsigned char> buffer;
+
+    MappedFile();
+};
+
+bool file_map(const std::string& path, MappedFile* file);
+void file_unmap(MappedFile* file);
+bool file_read(const std::string& path, std::vector<unsigned char>* data);
+bool file_write_atomic(const std::string& path, const std::vector<unsigned char>& data);
+bool file_make_directory(const std::string& path);
+// the modification time is in seconds since the epoch, false when the path doesn't exist or isn't a file
+bool file_stat(const std::string& path, uint64_t* size, int64_t* modified_time);
+// appends every file under path, recursing into directories, a path that is a file is appended as is
+bool file_list(const std::string& path, std::vector<std::string>* paths);
+uint64_t file_hash(const void* data, size_t size, uint64_t hash = FILE_HASH_SEED);
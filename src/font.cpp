@@ -2,6 +2,7 @@
 
 #include "globals.hpp"
 #include "shader.hpp"
+#include "pack.hpp"
 
 #include <glad/glad.h>
 #include <stb_image.h>
@@ -10,55 +11,42 @@
 
 const int ATLAS_FIRST_CHAR = 32;
 
-unsigned int glyph_vao;
-
 Font font_hack_10pt;
 
 void font_init() {
-    // buffer glyph vertex data
-    unsigned int glyph_vbo;
-
-    float glyph_vertices[12] = {
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        0.0f, 1.0f,
-        0.0f, 1.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-    };
-
-    glGenVertexArrays(1, &glyph_vao);
-    glGenBuffers(1, &glyph_vbo);
-    glBindVertexArray(glyph_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glyph_vertices), glyph_vertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // compile text shader
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCREEN_WIDTH), 0.0f, static_cast<float>(SCREEN_HEIGHT));
     glUseProgram(text_shader);
     glUniformMatrix4fv(glGetUniformLocation(text_shader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1i(glGetUniformLocation(text_shader, "u_texture"), 0);
+
+    // upload fonts, font_load has to have been called before
+    font_hack_10pt.upload();
+    // room for a screen full of glyphs, so turning an overlay on doesn't allocate mid game
+    font_hack_10pt.vertices.reserve((SCREEN_WIDTH / font_hack_10pt.glyph_size) * (SCREEN_HEIGHT / font_hack_10pt.glyph_size) * 6);
+}
+
+void font_flush() {
+    font_hack_10pt.flush();
+}
 
-    // load fonts
-    font_hack_10pt = Font("./hack_10pt.bmp", 10);
+void font_load() {
+    font_hack_10pt.load("./hack_10pt.bmp", 10);
 }
 
 Font::Font(const char* path, unsigned int size) {
-    glGenTextures(1, &atlas);
-    glBindTexture(GL_TEXTURE_2D, atlas);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    load(path, size);
+    upload();
+}
+
+void Font::load(const char* path, unsigned int size) {
     int width, height, num_channels;
-    unsigned char* data = stbi_load(path, &width, &height, &num_channels, 0);
+    std::vector<unsigned char> contents;
+    unsigned char* data = NULL;
+    if (pack_read(path, &contents) && !contents.empty()) {
+        data = stbi_load_from_memory(&contents[0], contents.size(), &width, &height, &num_channels, 3);
+    }
     if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+        pixels.assign(data, data + (width * height * 3));
         atlas_size = glm::vec2(width, height);
         glyph_size = size;
     } else {
@@ -67,32 +55,84 @@ Font::Font(const char* path, unsigned int size) {
     stbi_image_free(data);
 }
 
-void Font::render_text(std::string text, float x, float y, glm::vec3 color) {
-    glUseProgram(text_shader);
+void Font::upload() {
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (!pixels.empty()) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlas_size.x, atlas_size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+    }
+    std::vector<unsigned char>().swap(pixels);
 
-    glActiveTexture(GL_TEXTURE0);
+    // glyph quads are streamed into this every frame
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
-    glUniform3f(glGetUniformLocation(text_shader, "text_color"), color.x, color.y, color.z);
-    glUniform1i(glGetUniformLocation(text_shader, "u_texture"), 0);
-    glUniform2fv(glGetUniformLocation(text_shader, "texture_size"), 1, glm::value_ptr(atlas_size));
-    glUniform1i(glGetUniformLocation(text_shader, "glyph_size"), glyph_size);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void*)0);
 
-    glBindTexture(GL_TEXTURE_2D, atlas);
-    glBindVertexArray(glyph_vao);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void*)(2 * sizeof(float)));
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void*)(4 * sizeof(float)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void Font::render_text(const char* text, float x, float y, glm::vec3 color) {
+    // two triangles per glyph, as corners of the unit quad
+    const glm::vec2 corners[6] = {
+        glm::vec2(0.0f, 0.0f),
+        glm::vec2(1.0f, 0.0f),
+        glm::vec2(0.0f, 1.0f),
+        glm::vec2(0.0f, 1.0f),
+        glm::vec2(1.0f, 0.0f),
+        glm::vec2(1.0f, 1.0f)
+    };
 
     int glyphs_per_row = (int)(atlas_size.x / glyph_size);
 
-    for (unsigned int i = 0; i < text.length(); i++) {
+    for (unsigned int i = 0; text[i] != '\0'; i++) {
         int char_index = ((int)text[i]) - ATLAS_FIRST_CHAR;
         glm::vec2 glyph_coords = glm::vec2(x + (glyph_size * i), SCREEN_HEIGHT - glyph_size - y);
         glm::vec2 glyph_texture_coords = glm::vec2(char_index % glyphs_per_row, (int)(char_index / (float)glyphs_per_row));
 
-        glUniform2fv(glGetUniformLocation(text_shader, "glyph_coords"), 1, glm::value_ptr(glyph_coords));
-        glUniform2fv(glGetUniformLocation(text_shader, "texture_coords"), 1, glm::value_ptr(glyph_texture_coords));
+        for (unsigned int j = 0; j < 6; j++) {
+            vertices.push_back({
+                .position = glyph_coords + (corners[j] * (float)glyph_size),
+                .texture_coordinates = glm::vec2(
+                        ((glyph_texture_coords.x + corners[j].x) * glyph_size) / atlas_size.x,
+                        1.0f - (((glyph_texture_coords.y + 1.0f - corners[j].y) * glyph_size) / atlas_size.y)),
+                .color = color
+            });
+        }
+    }
+}
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+void Font::flush() {
+    if (vertices.empty()) {
+        return;
     }
 
+    glUseProgram(text_shader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GlyphVertex), &vertices[0], GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    vertices.clear();
 }
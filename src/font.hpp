@@ -2,17 +2,36 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
+
+struct GlyphVertex {
+    glm::vec2 position;
+    glm::vec2 texture_coordinates;
+    glm::vec3 color;
+};
 
 struct Font {
     unsigned int atlas;
+    unsigned int vao, vbo;
     unsigned int glyph_size;
     glm::vec2 atlas_size;
+    // decoded image, only kept around until it's uploaded
+    std::vector<unsigned char> pixels;
+    // glyphs queued by render_text since the last flush
+    std::vector<GlyphVertex> vertices;
 
     Font() { }
     Font(const char* path, unsigned int size);
-    void render_text(std::string text, float x, float y, glm::vec3 color);
+    void load(const char* path, unsigned int size);
+    void upload();
+    void render_text(const char* text, float x, float y, glm::vec3 color);
+    void flush();
 };
 
 extern Font font_hack_10pt;
 
+// font_load only decodes images, font_init needs the GL context
+void font_load();
 void font_init();
+// draws everything queued with render_text, once per render target, using the blend state at the time of the call
+void font_flush();
@@ -0,0 +1,110 @@
+#include "frame.hpp"
+
+#include "scene.hpp"
+#include "enemy.hpp"
+#include "profile.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// one snapshot is drawn while the other one is captured
+FrameSnapshot frame_snapshots[2];
+unsigned int frame_current_index = 0;
+
+bool frame_pipelined = false;
+std::thread frame_thread;
+std::mutex frame_mutex;
+std::condition_variable frame_condition;
+bool frame_running = false;
+bool frame_pending = false;
+float frame_pending_time = 0.0f;
+
+void frame_simulate(float frame_time) {
+    float interpolation = scene_advance(frame_time);
+    scene_capture(&frame_snapshots[1 - frame_current_index], interpolation);
+}
+
+void frame_worker() {
+    profile_thread_name("simulation");
+    std::unique_lock<std::mutex> lock(frame_mutex);
+    while (true) {
+        frame_condition.wait(lock, []() {
+            return frame_pending || !frame_running;
+        });
+        if (!frame_running) {
+            return;
+        }
+
+        float frame_time = frame_pending_time;
+        lock.unlock();
+        frame_simulate(frame_time);
+        lock.lock();
+
+        frame_pending = false;
+        frame_condition.notify_all();
+    }
+}
+
+void frame_init(bool pipelined) {
+    // as much as a frame can capture, so the snapshots never grow during play
+    for (FrameSnapshot& frame : frame_snapshots) {
+        frame.visible_sectors.reserve(sectors.size());
+        frame.decals.reserve(sectors.size() * LEVEL_MAX_BULLET_HOLES);
+        frame.billboards.reserve(enemies.size() * (1 + ENEMY_MAX_BULLET_HOLES));
+    }
+    frame_current_index = 0;
+    scene_capture(&frame_snapshots[frame_current_index], 1.0f);
+
+    frame_pipelined = pipelined;
+    frame_pending = false;
+    if (frame_pipelined) {
+        frame_running = true;
+        frame_thread = std::thread(frame_worker);
+    }
+}
+
+void frame_quit() {
+    if (!frame_pipelined) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        frame_running = false;
+    }
+    frame_condition.notify_all();
+    frame_thread.join();
+}
+
+void frame_begin(float frame_time) {
+    if (!frame_pipelined) {
+        frame_simulate(frame_time);
+        frame_current_index = 1 - frame_current_index;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        frame_pending = true;
+        frame_pending_time = frame_time;
+    }
+    frame_condition.notify_all();
+}
+
+const FrameSnapshot& frame_current() {
+    return frame_snapshots[frame_current_index];
+}
+
+void frame_end() {
+    if (!frame_pipelined) {
+        return;
+    }
+
+    ProfileScope profile_scope("wait for simulation");
+    std::unique_lock<std::mutex> lock(frame_mutex);
+    frame_condition.wait(lock, []() {
+        return !frame_pending;
+    });
+    frame_current_index = 1 - frame_current_index;
+}
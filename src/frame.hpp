@@ -0,0 +1,41 @@
+#pragma once
+
+#include "billboard.hpp"
+#include "level.hpp"
+#include "player.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// the game runs as a two stage pipeline, the simulation thread ticks and captures everything a frame needs to be drawn
+// into a snapshot, while the main thread draws the snapshot from the frame before with no access to the simulation
+
+struct FrameSnapshot {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 view_position;
+    glm::vec3 flashlight_direction;
+    bool flashlight_on;
+
+    std::vector<unsigned int> visible_sectors;
+    // level bullet holes
+    std::vector<Billboard> decals;
+    // enemies and the bullet holes stuck to them
+    std::vector<Billboard> billboards;
+    PlayerHud hud;
+
+    float elapsed;
+    float screen_anim_timer;
+    CullStats cull_stats;
+};
+
+// after scene_init, captures the first frame so there's something to draw before the first simulation finishes
+// without pipelining everything runs on the main thread and frames are drawn as soon as they're captured
+void frame_init(bool pipelined);
+void frame_quit();
+// starts simulating and capturing the next frame
+void frame_begin(float frame_time);
+// the frame to draw, it doesn't change until frame_end
+const FrameSnapshot& frame_current();
+// waits for the simulation, afterwards frame_current is the frame it captured
+void frame_end();
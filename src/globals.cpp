@@ -1,16 +1,30 @@
 #include "globals.hpp"
 
-#include <fstream>
+#include "pack.hpp"
+
 #include <cstdio>
+#include <algorithm>
+#include <sstream>
 
 bool disable_noise = false;
+float draw_distance = 0.0f;
+bool show_render_stats = false;
+bool texture_cache = true;
+unsigned int texture_budget_mb = 0;
+PacerMode frame_pacing = PACER_CAPPED;
+unsigned int max_fps = 60;
+unsigned int tick_rate = 60;
+bool pipelined_simulation = true;
+std::string stats_log = "";
+float stats_log_interval_seconds = 1.0f;
 
 bool config_init() {
-    std::ifstream file("./config.ini");
-    if (!file.is_open()) {
+    std::vector<unsigned char> contents;
+    if (!pack_read("./config.ini", &contents)) {
         printf("Could not open config.ini\n");
         return false;
     }
+    std::istringstream file(std::string(contents.begin(), contents.end()));
 
     std::string line;
     while (std::getline(file, line)) {
@@ -35,6 +49,32 @@ bool config_init() {
             WINDOW_HEIGHT = std::stoul(value);
         } else if (key == "disable_noise") {
             disable_noise = value == "1";
+        } else if (key == "draw_distance") {
+            draw_distance = std::stof(value);
+        } else if (key == "show_render_stats") {
+            show_render_stats = value == "1";
+        } else if (key == "texture_cache") {
+            texture_cache = value == "1";
+        } else if (key == "texture_budget_mb") {
+            texture_budget_mb = std::stoul(value);
+        } else if (key == "frame_pacing") {
+            if (value == "vsync") {
+                frame_pacing = PACER_VSYNC;
+            } else if (value == "uncapped") {
+                frame_pacing = PACER_UNCAPPED;
+            } else {
+                frame_pacing = PACER_CAPPED;
+            }
+        } else if (key == "max_fps") {
+            max_fps = std::stoul(value);
+        } else if (key == "tick_rate") {
+            tick_rate = std::max(1ul, std::stoul(value));
+        } else if (key == "pipelined_simulation") {
+            pipelined_simulation = value == "1";
+        } else if (key == "stats_log") {
+            stats_log = value;
+        } else if (key == "stats_log_interval") {
+            stats_log_interval_seconds = std::stof(value);
         }
     }
 
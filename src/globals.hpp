@@ -1,11 +1,19 @@
 #pragma once
 
+#include "pacer.hpp"
+
+#include <string>
+
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 360;
 
 const int NUM_TEXTURES = 3;
 
 extern bool edit_mode;
+// no window or GL context, only the simulation runs
+extern bool headless;
+// --trace-startup, prints what loading does: the startup task trace, textures loaded and unloaded, atlases, the pack and lightmap bakes
+extern bool trace_loading;
 extern unsigned int quad_vao;
 extern float elapsed;
 extern float screen_anim_timer;
@@ -14,5 +22,15 @@ extern float screen_anim_timer;
 extern unsigned int WINDOW_WIDTH;
 extern unsigned int WINDOW_HEIGHT;
 extern bool disable_noise;
+extern float draw_distance;
+extern bool show_render_stats;
+extern bool texture_cache;
+extern unsigned int texture_budget_mb;
+extern PacerMode frame_pacing;
+extern unsigned int max_fps;
+extern unsigned int tick_rate;
+extern bool pipelined_simulation;
+extern std::string stats_log;
+extern float stats_log_interval_seconds;
 
 bool config_init();
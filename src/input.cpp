@@ -24,6 +24,8 @@ void input_set_mapping() {
     input_map.insert({ SDLK_t, INPUT_T });
     input_map.insert({ SDLK_g, INPUT_G });
     input_map.insert({ SDLK_o, INPUT_O });
+    input_map.insert({ SDLK_z, INPUT_Z });
+    input_map.insert({ SDLK_y, INPUT_Y });
     input_map.insert({ SDLK_r, INPUT_RELOAD });
 }
 
@@ -56,8 +58,9 @@ void input_handle_event(SDL_Event e) {
         input.is_action_pressed[mapping->second] = false;
         input.is_action_just_released[mapping->second] = true;
     } else if (e.type == SDL_MOUSEMOTION) {
-        input.mouse_raw_xrel = e.motion.xrel;
-        input.mouse_raw_yrel = e.motion.yrel;
+        // summed, since several events can arrive before the motion gets used
+        input.mouse_raw_xrel += e.motion.xrel;
+        input.mouse_raw_yrel += e.motion.yrel;
         input.mouse_raw_x = e.motion.x;
         input.mouse_raw_y = e.motion.y;
 
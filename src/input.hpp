@@ -10,6 +10,8 @@ enum Input {
     INPUT_T,
     INPUT_G,
     INPUT_O,
+    INPUT_Z,
+    INPUT_Y,
     INPUT_FORWARD,
     INPUT_BACKWARD,
     INPUT_RIGHT,
@@ -5,14 +5,21 @@
 #include "globals.hpp"
 #include "resource.hpp"
 #include "raycast.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "pack.hpp"
+#include "lightmap.hpp"
 
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
+#include <sstream>
+#include <utility>
 
 std::string file_path;
 
@@ -21,17 +28,86 @@ std::vector<PointLight> lights;
 glm::vec3 player_spawn_point;
 std::vector<EnemySpawn> enemy_spawns;
 
+std::vector<bool> sector_visible;
+CullStats cull_stats;
+
+Frustum level_frustum;
+glm::vec3 level_view_pos;
+
 Sector::Sector() {
     has_generated_buffers = false;
+    vao = 0;
+    vbo = 0;
     floor_y = 0.0f;
     ceiling_y = 1.0f;
     ceiling_texture_index = 0;
     floor_texture_index = 0;
+    vertex_data_size = 0;
+}
+
+Sector::Sector(const Sector& other) : Sector() {
+    *this = other;
+}
+
+Sector::Sector(Sector&& other) noexcept : Sector() {
+    *this = std::move(other);
+}
+
+Sector& Sector::operator=(const Sector& other) {
+    // this sector keeps whatever buffers it had, they get refilled by init_buffers
+    vertices = other.vertices;
+    floor_y = other.floor_y;
+    ceiling_y = other.ceiling_y;
+    floor_texture_index = other.floor_texture_index;
+    ceiling_texture_index = other.ceiling_texture_index;
+    walls = other.walls;
+    aabb_top_left = other.aabb_top_left;
+    aabb_bot_right = other.aabb_bot_right;
+    std::copy(other.aabb, other.aabb + 8, aabb);
+    bullet_holes = other.bullet_holes;
+
+    return *this;
+}
+
+Sector& Sector::operator=(Sector&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    if (vao != 0) {
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+    }
+
+    vertices = std::move(other.vertices);
+    floor_y = other.floor_y;
+    ceiling_y = other.ceiling_y;
+    floor_texture_index = other.floor_texture_index;
+    ceiling_texture_index = other.ceiling_texture_index;
+    walls = std::move(other.walls);
+    aabb_top_left = other.aabb_top_left;
+    aabb_bot_right = other.aabb_bot_right;
+    std::copy(other.aabb, other.aabb + 8, aabb);
+    bullet_holes = std::move(other.bullet_holes);
+
+    has_generated_buffers = other.has_generated_buffers;
+    vao = other.vao;
+    vbo = other.vbo;
+    vertex_data_size = other.vertex_data_size;
+    other.has_generated_buffers = false;
+    other.vao = 0;
+    other.vbo = 0;
+    other.vertex_data_size = 0;
+
+    return *this;
 }
 
 Sector::~Sector() {
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
+    // sectors are also created while parsing the map on a task thread, where there's no GL context
+    if (vao != 0) {
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+    }
 }
 
 void Sector::add_vertex(const glm::vec2 vertex, unsigned int texture_index, bool wall_exists) {
@@ -44,7 +120,13 @@ void Sector::add_vertex(const glm::vec2 vertex, unsigned int texture_index, bool
 }
 
 void Sector::init_buffers(unsigned int index) {
-    std::vector<VertexData> vertex_data;
+    SectorMesh mesh;
+    build_mesh(index, &mesh);
+    upload_mesh(mesh);
+}
+
+void Sector::build_mesh(unsigned int index, SectorMesh* mesh) {
+    std::vector<VertexData>& vertex_data = mesh->vertex_data;
 
     // walls
     for (unsigned int i = 0; i < vertices.size(); i++) {
@@ -78,7 +160,17 @@ void Sector::init_buffers(unsigned int index) {
             glm::vec2(wall_scale.x, 0.0f),
             glm::vec2(0.0f, 0.0f)
         };
+        glm::vec2 lightmap_coordinates[6] = {
+            glm::vec2(0.0f, 1.0f),
+            glm::vec2(1.0f, 1.0f),
+            glm::vec2(0.0f, 0.0f),
 
+            glm::vec2(1.0f, 1.0f),
+            glm::vec2(1.0f, 0.0f),
+            glm::vec2(0.0f, 0.0f)
+        };
+
+        unsigned int first_vertex = vertex_data.size();
         for (unsigned int face = 0; face < 2; face++) {
             unsigned int base_index = face * 3;
             glm::vec3 face_normal = glm::normalize(glm::cross(wall_vertices[base_index + 2] - wall_vertices[base_index], wall_vertices[base_index + 1] - wall_vertices[base_index]));
@@ -88,7 +180,8 @@ void Sector::init_buffers(unsigned int index) {
                     .position = wall_vertices[base_index + j],
                     .normal = face_normal,
                     .texture_index = walls[i].texture_index,
-                    .texture_coordinates = texture_coordinates[base_index + j]
+                    .texture_coordinates = texture_coordinates[base_index + j],
+                    .lightmap_coordinates = lightmap_coordinates[base_index + j]
                 });
             }
 
@@ -97,7 +190,16 @@ void Sector::init_buffers(unsigned int index) {
             }
         }
 
-        raycast_add_plane({
+        mesh->charts.push_back({
+            .origin = wall_bot_left,
+            .u_axis = wall_bot_right - wall_bot_left,
+            .v_axis = wall_top_left - wall_bot_left,
+            .normal = walls[i].normal,
+            .first_vertex = first_vertex,
+            .vertex_count = 6
+        });
+
+        mesh->planes.push_back({
             .type = PLANE_TYPE_LEVEL,
             .id = index,
             .a = wall_top_left,
@@ -128,7 +230,7 @@ void Sector::init_buffers(unsigned int index) {
     aabb[7] = glm::vec4(aabb_top_left.x, floor_y, aabb_bot_right.y, 1.0f); // floor bot left
 
     // ceiling
-    raycast_add_plane({
+    mesh->planes.push_back({
         .type = PLANE_TYPE_LEVEL,
         .id = index,
         .a = glm::vec3(aabb[0]),
@@ -140,7 +242,7 @@ void Sector::init_buffers(unsigned int index) {
     });
 
     // floor
-    raycast_add_plane({
+    mesh->planes.push_back({
         .type = PLANE_TYPE_LEVEL,
         .id = index,
         .a = aabb[4],
@@ -208,46 +310,64 @@ void Sector::init_buffers(unsigned int index) {
     // add the last triangle
     ceiling_triangle_vertices.push_back(glm::ivec3(remaining_vertices[0], remaining_vertices[1], remaining_vertices[2]));
 
-    // make ceiling and floor triangles out of the triangles formed above
+    // make ceiling and floor triangles out of the triangles formed above, all of the ceiling first so that each is one lightmap chart
     glm::vec2 ceiling_scale = glm::vec2(std::fabs(aabb_bot_right.x - aabb_top_left.x), std::fabs(aabb_top_left.y - aabb_bot_right.y));
-    for (glm::ivec3 ceiling_triangle : ceiling_triangle_vertices) {
-        glm::vec3 triangle_vertices[3] = {
-            glm::vec3(vertices[ceiling_triangle[0]].x, ceiling_y, vertices[ceiling_triangle[0]].y),
-            glm::vec3(vertices[ceiling_triangle[1]].x, ceiling_y, vertices[ceiling_triangle[1]].y),
-            glm::vec3(vertices[ceiling_triangle[2]].x, ceiling_y, vertices[ceiling_triangle[2]].y),
-        };
-        glm::vec3 face_normal = glm::normalize(glm::cross(triangle_vertices[1] - triangle_vertices[0], triangle_vertices[2] - triangle_vertices[0]));
-        for (unsigned int j = 0; j < 3; j++) {
-            vertex_data.push_back({
-                .position = triangle_vertices[j],
-                .normal = face_normal,
-                .texture_index = ceiling_texture_index,
-                .texture_coordinates = glm::vec2(
-                        ((triangle_vertices[j].x - aabb_top_left.x) / ceiling_scale.x) * ceiling_scale.x,
-                        (std::fabs(triangle_vertices[j].z - aabb_bot_right.y) / ceiling_scale.y) * ceiling_scale.y)
-            });
+    for (unsigned int surface = 0; surface < 2; surface++) {
+        bool is_ceiling = surface == 0;
+        float surface_y = is_ceiling ? ceiling_y : floor_y;
+        unsigned int first_vertex = vertex_data.size();
+
+        for (glm::ivec3 ceiling_triangle : ceiling_triangle_vertices) {
+            glm::vec3 triangle_vertices[3] = {
+                glm::vec3(vertices[ceiling_triangle[0]].x, surface_y, vertices[ceiling_triangle[0]].y),
+                glm::vec3(vertices[ceiling_triangle[1]].x, surface_y, vertices[ceiling_triangle[1]].y),
+                glm::vec3(vertices[ceiling_triangle[2]].x, surface_y, vertices[ceiling_triangle[2]].y),
+            };
+            glm::vec3 face_normal = is_ceiling ?
+                glm::normalize(glm::cross(triangle_vertices[1] - triangle_vertices[0], triangle_vertices[2] - triangle_vertices[0])) :
+                glm::normalize(glm::cross(triangle_vertices[2] - triangle_vertices[0], triangle_vertices[1] - triangle_vertices[0]));
+            for (unsigned int j = 0; j < 3; j++) {
+                vertex_data.push_back({
+                    .position = triangle_vertices[j],
+                    .normal = face_normal,
+                    .texture_index = is_ceiling ? ceiling_texture_index : floor_texture_index,
+                    .texture_coordinates = glm::vec2(
+                            ((triangle_vertices[j].x - aabb_top_left.x) / ceiling_scale.x) * ceiling_scale.x,
+                            (std::fabs(triangle_vertices[j].z - aabb_bot_right.y) / ceiling_scale.y) * ceiling_scale.y),
+                    .lightmap_coordinates = glm::vec2(
+                            (triangle_vertices[j].x - aabb_top_left.x) / ceiling_scale.x,
+                            (triangle_vertices[j].z - aabb_top_left.y) / ceiling_scale.y)
+                });
+            }
         }
 
-        for (unsigned int j = 0; j < 3; j++) {
-            triangle_vertices[j].y = floor_y;
-        }
-        face_normal = glm::normalize(glm::cross(triangle_vertices[2] - triangle_vertices[0], triangle_vertices[1] - triangle_vertices[0]));
-        for (unsigned int j = 0; j < 3; j++) {
-            vertex_data.push_back({
-                .position = triangle_vertices[j],
-                .normal = face_normal,
-                .texture_index = floor_texture_index,
-                .texture_coordinates = glm::vec2(
-                        ((triangle_vertices[j].x - aabb_top_left.x) / ceiling_scale.x) * ceiling_scale.x,
-                        (std::fabs(triangle_vertices[j].z - aabb_bot_right.y) / ceiling_scale.y) * ceiling_scale.y)
-            });
-        }
+        // the chart covers the sector's bounding box, the texels outside of the polygon are baked but never sampled
+        mesh->charts.push_back({
+            .origin = glm::vec3(aabb_top_left.x, surface_y, aabb_top_left.y),
+            .u_axis = glm::vec3(ceiling_scale.x, 0.0f, 0.0f),
+            .v_axis = glm::vec3(0.0f, 0.0f, ceiling_scale.y),
+            .normal = glm::vec3(0.0f, is_ceiling ? -1.0f : 1.0f, 0.0f),
+            .first_vertex = first_vertex,
+            .vertex_count = (unsigned int)(vertex_data.size() - first_vertex)
+        });
     }
+}
 
+void Sector::upload_mesh(const SectorMesh& mesh) {
+    // planes are added here instead of in build_mesh so that they stay in sector order however meshes get built
+    for (const RaycastPlane& plane : mesh.planes) {
+        raycast_add_plane(plane);
+    }
+
+    upload_buffers(mesh.vertex_data);
+}
+
+void Sector::upload_buffers(const std::vector<VertexData>& vertex_data) {
     // insert vertex data into buffers
     if (!has_generated_buffers) {
         glGenVertexArrays(1, &vao);
         glGenBuffers(1, &vbo);
+        has_generated_buffers = true;
     }
 
     glBindVertexArray(vao);
@@ -267,6 +387,9 @@ void Sector::init_buffers(unsigned int index) {
     glEnableVertexAttribArray(3);
     glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)((6 * sizeof(float)) + sizeof(unsigned int)));
 
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)((8 * sizeof(float)) + sizeof(unsigned int)));
+
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -274,36 +397,51 @@ void Sector::init_buffers(unsigned int index) {
 }
 
 void Sector::render() {
+    ProfileScope profile_scope("Sector::render");
     // render level geometry
     glUseProgram(texture_shader);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_textures);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_info(resource_textures).texture);
     glBindVertexArray(vao);
     glDrawArrays(GL_TRIANGLES, 0, vertex_data_size);
     glBindVertexArray(0);
+}
 
-    // bind quad vertex
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_bullet_hole);
-    glBindVertexArray(quad_vao);
-
-    // render bullet holes
-    glUseProgram(billboard_shader);
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), 0);
-    glUniform2iv(glGetUniformLocation(billboard_shader, "extents"), 1, glm::value_ptr(resource_extents[resource_bullet_hole]));
+void Sector::capture_bullet_holes(std::vector<Billboard>* decals) const {
+    float bullet_hole_radius = level_billboard_radius(resource_info(resource_bullet_hole).extents);
     for (const LevelBulletHole& bullet_hole : bullet_holes) {
+        if (!level_is_billboard_visible(bullet_hole.position, bullet_hole_radius, -1)) {
+            continue;
+        }
+
         glm::vec3 bullet_hole_up = glm::vec3(0.0f, 1.0f, 0.0f);
         if (std::abs(glm::dot(bullet_hole_up, bullet_hole.normal)) == 1.0f) {
             bullet_hole_up = glm::vec3(0.0f, 0.0f, 1.0f);
         }
-        glm::mat4 model = glm::inverse(glm::lookAt(bullet_hole.position, bullet_hole.position - bullet_hole.normal, bullet_hole_up));
-        glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(bullet_hole.normal));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        decals->push_back({
+            .sprite = resource_bullet_hole,
+            .frame = 0,
+            .model = glm::inverse(glm::lookAt(bullet_hole.position, bullet_hole.position - bullet_hole.normal, bullet_hole_up)),
+            .normal = bullet_hole.normal,
+            .flip_h = false
+        });
     }
 }
 
+bool Sector::contains(glm::vec2 point) const {
+    glm::vec2 raycast_start = aabb_top_left - glm::vec2(1.0f, 1.0f);
+    glm::vec2 raycast_direction = point - raycast_start;
+    unsigned int hits = 0;
+    for (unsigned int wall = 0; wall < vertices.size(); wall++) {
+        float raycast_result = raycast_cast2d(raycast_start, raycast_direction, vertices[wall], vertices[(wall + 1) % vertices.size()] - vertices[wall]);
+        if (raycast_result != -1.0f) {
+            hits++;
+        }
+    }
+
+    return hits % 2 == 1;
+}
+
 Frustum::Frustum(const glm::mat4& projection_view_transpose) {
     plane[0] = glm::vec4(projection_view_transpose[3] + projection_view_transpose[0]); // left
     plane[1] = glm::vec4(projection_view_transpose[3] - projection_view_transpose[0]); // right
@@ -330,6 +468,18 @@ bool Frustum::is_inside(const Sector& sector) const {
     return true;
 }
 
+bool Frustum::is_inside(glm::vec3 center, float radius) const {
+    // the planes aren't normalized, so scale the radius by each plane normal's length instead
+    for (unsigned int plane_index = 0; plane_index < 6; plane_index++) {
+        float distance = glm::dot(glm::vec3(plane[plane_index]), center) + plane[plane_index].w;
+        if (distance < -radius * glm::length(glm::vec3(plane[plane_index]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 std::vector<std::string> split_string(std::string s, std::string delimeter) {
     std::vector<std::string> words;
     std::size_t pos_start = 0;
@@ -396,14 +546,25 @@ void level_save_file() {
 
 
 void level_init(std::string path) {
+    level_load(path);
+    if (headless) {
+        level_init_planes();
+        return;
+    }
+    level_init_lighting();
+    level_init_sectors();
+}
+
+void level_load(std::string path) {
     player_spawn_point = glm::vec3(0.0f, 1.0f, 0.0f);
 
     // load from file
     file_path = path;
     if (path != "") {
-        std::ifstream file(path);
+        std::vector<unsigned char> contents;
         std::string line;
-        if (file.is_open()) {
+        if (pack_read(path, &contents)) {
+            std::istringstream file(std::string(contents.begin(), contents.end()));
             while (std::getline(file, line)) {
                 std::vector<std::string> words = split_string(line, " ");
 
@@ -435,50 +596,161 @@ void level_init(std::string path) {
                     sectors.push_back(new_sector);
                 }
             }
-            file.close();
         }
     }
+}
 
+void level_init_lighting() {
     glUseProgram(texture_shader);
     glUniform1i(glGetUniformLocation(texture_shader, "texture_array"), 0);
+    glUniform1i(glGetUniformLocation(texture_shader, "lightmap"), 1);
     glUniform1ui(glGetUniformLocation(texture_shader, "lighting_enabled"), !edit_mode);
 
+    // the level geometry has its point lights baked into the lightmap, only billboards still light themselves with them
+    glUseProgram(billboard_shader);
+    glUniform1ui(glGetUniformLocation(billboard_shader, "point_light_count"), lights.size());
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        std::string shader_var_name = "point_lights[" + std::to_string(i) + "]";
+        glUniform3fv(glGetUniformLocation(billboard_shader, (shader_var_name + ".position").c_str()), 1, glm::value_ptr(lights[i].position));
+        glUniform1f(glGetUniformLocation(billboard_shader, (shader_var_name + ".constant").c_str()), lights[i].constant);
+        glUniform1f(glGetUniformLocation(billboard_shader, (shader_var_name + ".linear").c_str()), lights[i].linear);
+        glUniform1f(glGetUniformLocation(billboard_shader, (shader_var_name + ".quadratic").c_str()), lights[i].quadratic);
+    }
+
     unsigned int shaders_with_lighting[] = { texture_shader, billboard_shader };
 
     for (unsigned int shader_index = 0; shader_index < 2; shader_index++) {
         unsigned int shader = shaders_with_lighting[shader_index];
         glUseProgram(shader);
 
-        glUniform1ui(glGetUniformLocation(shader, "point_light_count"), lights.size());
-        for (unsigned int i = 0; i < lights.size(); i++) {
-            std::string shader_var_name = "point_lights[" + std::to_string(i) + "]";
-            glUniform3fv(glGetUniformLocation(shader, (shader_var_name + ".position").c_str()), 1, glm::value_ptr(lights[i].position));
-            glUniform1f(glGetUniformLocation(shader, (shader_var_name + ".constant").c_str()), lights[i].constant);
-            glUniform1f(glGetUniformLocation(shader, (shader_var_name + ".linear").c_str()), lights[i].linear);
-            glUniform1f(glGetUniformLocation(shader, (shader_var_name + ".quadratic").c_str()), lights[i].quadratic);
-        }
-
         glUniform1f(glGetUniformLocation(shader, "player_flashlight.constant"), 1.0f);
         glUniform1f(glGetUniformLocation(shader, "player_flashlight.linear"), 0.09);
         glUniform1f(glGetUniformLocation(shader, "player_flashlight.quadratic"), 0.032f);
         glUniform1f(glGetUniformLocation(shader, "player_flashlight.cutoff"), glm::cos(glm::radians(12.5f)));
         glUniform1f(glGetUniformLocation(shader, "player_flashlight.outer_cutoff"), glm::cos(glm::radians(17.5f)));
     }
-
-    level_init_sectors();
 }
 
 void level_init_sectors() {
+    // every mesh has to be built before the atlas can be laid out, and every plane added before the bake
+    std::vector<SectorMesh> meshes(sectors.size());
+    for (unsigned int i = 0; i < sectors.size(); i++) {
+        sectors[i].build_mesh(i, &meshes[i]);
+    }
+    lightmap_layout(&meshes);
+
     raycast_planes.clear();
     for (unsigned int i = 0; i < sectors.size(); i++) {
-        sectors[i].init_buffers(i);
+        sectors[i].upload_mesh(meshes[i]);
     }
+    lightmap_bake();
+    lightmap_upload();
 }
 
-void level_render(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, glm::vec3 flashlight_direction, bool flashlight_on) {
+void level_init_planes() {
+    // the same planes and wall normals as level_init_sectors, without the GPU buffers
+    raycast_planes.clear();
+    for (unsigned int i = 0; i < sectors.size(); i++) {
+        SectorMesh mesh;
+        sectors[i].build_mesh(i, &mesh);
+        for (const RaycastPlane& plane : mesh.planes) {
+            raycast_add_plane(plane);
+        }
+    }
+}
+
+bool is_level_plane_before(const RaycastPlane& plane, unsigned int sector) {
+    return plane.type == PLANE_TYPE_LEVEL && plane.id < sector;
+}
+
+void level_init_sector(unsigned int index) {
+    SectorMesh mesh;
+    sectors[index].build_mesh(index, &mesh);
+
+    // level planes are in sector order, so the sector's old planes are one run that gets swapped for the new ones
+    std::vector<RaycastPlane>::iterator first = raycast_planes.begin();
+    while (first != raycast_planes.end() && is_level_plane_before(*first, index)) {
+        first++;
+    }
+    std::vector<RaycastPlane>::iterator last = first;
+    while (last != raycast_planes.end() && last->type == PLANE_TYPE_LEVEL && last->id == index) {
+        last++;
+    }
+    first = raycast_planes.erase(first, last);
+    raycast_planes.insert(first, mesh.planes.begin(), mesh.planes.end());
+
+    sectors[index].upload_buffers(mesh.vertex_data);
+}
+
+void level_sector_inserted(unsigned int index) {
+    for (RaycastPlane& plane : raycast_planes) {
+        if (plane.type == PLANE_TYPE_LEVEL && plane.id >= index) {
+            plane.id++;
+        }
+    }
+    level_init_sector(index);
+}
+
+void level_sector_erased(unsigned int index) {
+    raycast_planes.erase(std::remove_if(raycast_planes.begin(), raycast_planes.end(), [index](const RaycastPlane& plane) {
+        return plane.type == PLANE_TYPE_LEVEL && plane.id == index;
+    }), raycast_planes.end());
+    for (RaycastPlane& plane : raycast_planes) {
+        if (plane.type == PLANE_TYPE_LEVEL && plane.id > index) {
+            plane.id--;
+        }
+    }
+}
+
+void level_cull(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, std::vector<unsigned int>* visible_sectors, std::vector<Billboard>* decals) {
+    ProfileScope profile_scope("level_cull");
+    glm::mat4 projection_view_transpose = glm::transpose(projection * view);
+    level_frustum = Frustum(projection_view_transpose);
+    level_view_pos = view_pos;
+
+    cull_stats = {
+        .sectors_drawn = 0,
+        .sectors_culled = 0,
+        .billboards_drawn = 0,
+        .billboards_culled = 0
+    };
+    sector_visible.assign(sectors.size(), false);
+    visible_sectors->clear();
+    decals->clear();
+    for (unsigned int i = 0; i < sectors.size(); i++) {
+        if (!level_frustum.is_inside(sectors[i])) {
+            cull_stats.sectors_culled++;
+            continue;
+        }
+        if (draw_distance > 0.0f) {
+            glm::vec3 closest_point = glm::clamp(view_pos,
+                                                 glm::vec3(sectors[i].aabb_top_left.x, sectors[i].floor_y, sectors[i].aabb_top_left.y),
+                                                 glm::vec3(sectors[i].aabb_bot_right.x, sectors[i].ceiling_y, sectors[i].aabb_bot_right.y));
+            if (glm::length(closest_point - view_pos) > draw_distance) {
+                cull_stats.sectors_culled++;
+                continue;
+            }
+        }
+
+        sector_visible[i] = true;
+        cull_stats.sectors_drawn++;
+        visible_sectors->push_back(i);
+    }
+    stats_add(STAT_SECTORS_VISIBLE, cull_stats.sectors_drawn);
+    stats_add(STAT_SECTORS_CULLED, cull_stats.sectors_culled);
+
+    // only once every sector's visibility is known, since billboards are checked against it
+    for (unsigned int sector : *visible_sectors) {
+        sectors[sector].capture_bullet_holes(decals);
+    }
+}
+
+void level_draw(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, glm::vec3 flashlight_direction, bool flashlight_on, const std::vector<unsigned int>& visible_sectors, const std::vector<Billboard>& decals) {
+    ProfileScope profile_scope("level_draw");
     glUseProgram(texture_shader);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_textures);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_info(resource_textures).texture);
+    lightmap_bind(1);
 
     glUniform1ui(glGetUniformLocation(texture_shader, "flashlight_on"), flashlight_on);
     glUniformMatrix4fv(glGetUniformLocation(texture_shader, "view"), 1, GL_FALSE, glm::value_ptr(view));
@@ -487,14 +759,67 @@ void level_render(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, glm:
     glUniform3fv(glGetUniformLocation(texture_shader, "player_flashlight.position"), 1, glm::value_ptr(view_pos));
     glUniform3fv(glGetUniformLocation(texture_shader, "player_flashlight.direction"), 1, glm::value_ptr(flashlight_direction));
 
-    glm::mat4 projection_view_transpose = glm::transpose(projection * view);
-    Frustum frustum = Frustum(projection_view_transpose);
+    for (unsigned int sector : visible_sectors) {
+        sectors[sector].render();
+    }
+
+    // bullet holes go over all the walls at once instead of after each sector, the depth test sorts them out either way
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(billboard_shader);
+    billboard_draw(decals);
+}
+
+void level_render(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, glm::vec3 flashlight_direction, bool flashlight_on) {
+    ProfileScope profile_scope("level_render");
+    std::vector<unsigned int> visible_sectors;
+    std::vector<Billboard> decals;
+    level_cull(view, projection, view_pos, &visible_sectors, &decals);
+    level_draw(view, projection, view_pos, flashlight_direction, flashlight_on, visible_sectors, decals);
+}
+
+int level_find_sector(glm::vec3 position) {
+    // AABBs overlap around L-shaped and nested sectors, so every sector is checked and an ambiguous position gets no sector
+    int found_sector = -1;
+    glm::vec2 position2d = glm::vec2(position.x, position.z);
     for (unsigned int i = 0; i < sectors.size(); i++) {
-        if (!frustum.is_inside(sectors[i])) {
+        const Sector& sector = sectors[i];
+        if (position.x < sector.aabb_top_left.x || position.x > sector.aabb_bot_right.x ||
+            position.z < sector.aabb_top_left.y || position.z > sector.aabb_bot_right.y ||
+            position.y < sector.floor_y || position.y > sector.ceiling_y) {
+            continue;
+        }
+        if (!sector.contains(position2d)) {
             continue;
         }
+        if (found_sector != -1) {
+            return -1;
+        }
+        found_sector = i;
+    }
+
+    return found_sector;
+}
+
+float level_billboard_radius(glm::ivec2 extents) {
+    // billboard quads are sized in screen pixels relative to the internal resolution, see billboard_vertex.glsl
+    return glm::length(glm::vec2(extents.x / (SCREEN_WIDTH / 2.0f), extents.y / (SCREEN_HEIGHT / 2.0f)));
+}
 
-        sectors[i].render();
+bool level_is_billboard_visible(glm::vec3 position, float radius, int sector) {
+    // sector visibility is decided once per frame in level_render, so this is the cheapest rejection
+    if (sector >= 0 && sector < (int)sector_visible.size() && !sector_visible[sector]) {
+        cull_stats.billboards_culled++;
+        return false;
+    }
+    if (draw_distance > 0.0f && glm::length(position - level_view_pos) - radius > draw_distance) {
+        cull_stats.billboards_culled++;
+        return false;
+    }
+    if (!level_frustum.is_inside(position, radius)) {
+        cull_stats.billboards_culled++;
+        return false;
     }
 
+    cull_stats.billboards_drawn++;
+    return true;
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "raycast.hpp"
+#include "billboard.hpp"
+
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
@@ -9,6 +12,7 @@ struct VertexData {
     glm::vec3 normal;
     unsigned int texture_index;
     glm::vec2 texture_coordinates;
+    glm::vec2 lightmap_coordinates;
 };
 
 struct Wall {
@@ -25,6 +29,9 @@ struct PointLight {
     float quadratic;
 };
 
+// once a sector has this many the oldest ones make way, so the list never outgrows what scene_init reserved
+const unsigned int LEVEL_MAX_BULLET_HOLES = 32;
+
 struct LevelBulletHole {
     glm::vec3 position;
     glm::vec3 normal;
@@ -35,6 +42,24 @@ struct EnemySpawn {
     glm::vec2 direction;
 };
 
+// one flat face of a sector that gets its own rectangle in the lightmap, origin + (s * u_axis) + (t * v_axis) covers it for s and t in 0 to 1
+struct LightmapChart {
+    glm::vec3 origin;
+    glm::vec3 u_axis;
+    glm::vec3 v_axis;
+    glm::vec3 normal;
+    // the vertices that lie on the chart, their lightmap coordinates are s and t until the atlas is laid out
+    unsigned int first_vertex;
+    unsigned int vertex_count;
+};
+
+// everything init_buffers produces that doesn't need the GL context
+struct SectorMesh {
+    std::vector<VertexData> vertex_data;
+    std::vector<RaycastPlane> planes;
+    std::vector<LightmapChart> charts;
+};
+
 struct Sector {
     std::vector<glm::vec2> vertices;
     float floor_y;
@@ -54,16 +79,38 @@ struct Sector {
     std::vector<LevelBulletHole> bullet_holes;
 
     Sector();
+    // copies get their own buffers on the next init_buffers, moves take the buffers over
+    Sector(const Sector& other);
+    Sector(Sector&& other) noexcept;
+    Sector& operator=(const Sector& other);
+    Sector& operator=(Sector&& other) noexcept;
     ~Sector();
     void add_vertex(const glm::vec2 vertex, unsigned int texture_index, bool wall_exists);
     void init_buffers(unsigned int index);
+    // build_mesh doesn't touch GL or any shared state, so sectors can be built in parallel
+    void build_mesh(unsigned int index, SectorMesh* mesh);
+    void upload_mesh(const SectorMesh& mesh);
+    void upload_buffers(const std::vector<VertexData>& vertex_data);
+    // only the geometry, bullet holes are recorded separately so they can be drawn from a frame snapshot
     void render();
+    void capture_bullet_holes(std::vector<Billboard>* decals) const;
+    // whether the point is inside of the sector's outline, by the parity of the walls crossed on the way in from outside its AABB
+    bool contains(glm::vec2 point) const;
 };
 
 struct Frustum {
     glm::vec4 plane[6];
+    Frustum() { }
     Frustum(const glm::mat4& projection_view_transpose);
     bool is_inside(const Sector& sector) const;
+    bool is_inside(glm::vec3 center, float radius) const;
+};
+
+struct CullStats {
+    unsigned int sectors_drawn;
+    unsigned int sectors_culled;
+    unsigned int billboards_drawn;
+    unsigned int billboards_culled;
 };
 
 extern std::vector<Sector> sectors;
@@ -71,8 +118,30 @@ extern std::vector<PointLight> lights;
 extern glm::vec3 player_spawn_point;
 extern std::vector<EnemySpawn> enemy_spawns;
 
+extern std::vector<bool> sector_visible;
+extern CullStats cull_stats;
+
 void level_save_file();
 void level_init(std::string path);
+// level_load only parses the map file, the other two need the GL context
+void level_load(std::string path);
+void level_init_lighting();
+// also bakes the lightmap, so the editor calls it again to see its changes lit
 void level_init_sectors();
+void level_init_planes();
+// rebuilds one sector's mesh and raycast planes after it was edited
+// its lightmap coordinates aren't in the atlas until the next level_init_sectors, so the editor draws the level unlit until it has baked again
+void level_init_sector(unsigned int index);
+// keep the raycast plane ids in step after a sector was inserted into or erased from sectors
+void level_sector_inserted(unsigned int index);
+void level_sector_erased(unsigned int index);
 void level_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta);
+// finds the visible sectors and their bullet holes, doesn't touch GL so it can run on the simulation thread
+void level_cull(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, std::vector<unsigned int>* visible_sectors, std::vector<Billboard>* decals);
+void level_draw(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, glm::vec3 flashlight_direction, bool flashlight_on, const std::vector<unsigned int>& visible_sectors, const std::vector<Billboard>& decals);
+// culls and draws in one go, for the editor
 void level_render(glm::mat4 view, glm::mat4 projection, glm::vec3 view_pos, glm::vec3 flashlight_direction, bool flashlight_on);
+// the sector whose outline and height range hold the position, or -1 when it's in none of them or in more than one
+int level_find_sector(glm::vec3 position);
+float level_billboard_radius(glm::ivec2 extents);
+bool level_is_billboard_visible(glm::vec3 position, float radius, int sector);
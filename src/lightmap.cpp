@@ -0,0 +1,203 @@
+#include "lightmap.hpp"
+
+#include "globals.hpp"
+#include "raycast.hpp"
+#include "profile.hpp"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <utility>
+
+// past this the texel density of every chart is halved until the atlas fits
+const unsigned int LIGHTMAP_MAX_HEIGHT = 8192;
+// shadow rays start this far off the surface so that they don't hit the plane the texel is on
+const float LIGHTMAP_SHADOW_OFFSET = 0.01f;
+
+// a chart's texels in the atlas, with a one texel border around them that repeats its edge so filtering doesn't bleed
+struct LightmapAtlasChart {
+    LightmapChart chart;
+    glm::ivec2 position;
+    glm::ivec2 size;
+};
+
+// one row of one chart's texels, border included, rows are what the bake threads take turns on
+struct LightmapRow {
+    unsigned int chart;
+    unsigned int row;
+};
+
+unsigned int lightmap_texture = 0;
+unsigned int lightmap_thread_count = 1;
+
+std::vector<LightmapAtlasChart> lightmap_charts;
+std::vector<LightmapRow> lightmap_rows;
+glm::ivec2 lightmap_size;
+std::vector<float> lightmap_texels;
+
+void lightmap_layout(std::vector<SectorMesh>* meshes) {
+    ProfileScope profile_scope("lightmap_layout");
+    std::vector<std::pair<unsigned int, unsigned int>> mesh_charts;
+    for (unsigned int mesh = 0; mesh < meshes->size(); mesh++) {
+        for (unsigned int chart = 0; chart < (*meshes)[mesh].charts.size(); chart++) {
+            mesh_charts.push_back(std::pair<unsigned int, unsigned int>(mesh, chart));
+        }
+    }
+
+    // shelves, tallest charts first so that each shelf wastes as little height as it can
+    float texels_per_unit = LIGHTMAP_TEXELS_PER_UNIT;
+    while (true) {
+        lightmap_charts.clear();
+        for (std::pair<unsigned int, unsigned int> mesh_chart : mesh_charts) {
+            const LightmapChart& chart = (*meshes)[mesh_chart.first].charts[mesh_chart.second];
+            glm::ivec2 size = glm::ivec2(std::ceil(glm::length(chart.u_axis) * texels_per_unit), std::ceil(glm::length(chart.v_axis) * texels_per_unit));
+            lightmap_charts.push_back({
+                .chart = chart,
+                .position = glm::ivec2(0, 0),
+                .size = glm::clamp(size, glm::ivec2(1, 1), glm::ivec2(LIGHTMAP_MAX_CHART_SIZE, LIGHTMAP_MAX_CHART_SIZE))
+            });
+        }
+
+        std::vector<unsigned int> order;
+        for (unsigned int i = 0; i < lightmap_charts.size(); i++) {
+            order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [](unsigned int a, unsigned int b) {
+            return lightmap_charts[a].size.y > lightmap_charts[b].size.y;
+        });
+
+        glm::ivec2 shelf_position = glm::ivec2(0, 0);
+        int shelf_height = 0;
+        for (unsigned int i : order) {
+            glm::ivec2 footprint = lightmap_charts[i].size + glm::ivec2(2, 2);
+            if (shelf_position.x + footprint.x > (int)LIGHTMAP_WIDTH) {
+                shelf_position = glm::ivec2(0, shelf_position.y + shelf_height);
+                shelf_height = 0;
+            }
+            lightmap_charts[i].position = shelf_position;
+            shelf_position.x += footprint.x;
+            shelf_height = std::max(shelf_height, footprint.y);
+        }
+        lightmap_size = glm::ivec2(LIGHTMAP_WIDTH, std::max(1, shelf_position.y + shelf_height));
+
+        if (lightmap_size.y <= (int)LIGHTMAP_MAX_HEIGHT) {
+            break;
+        }
+        texels_per_unit *= 0.5f;
+    }
+
+    // texel centers are at half texels, so s and t of 0 and 1 land on the first and last texel's outer edge
+    lightmap_rows.clear();
+    for (unsigned int i = 0; i < lightmap_charts.size(); i++) {
+        const LightmapAtlasChart& atlas_chart = lightmap_charts[i];
+        std::vector<VertexData>& vertex_data = (*meshes)[mesh_charts[i].first].vertex_data;
+        for (unsigned int vertex = atlas_chart.chart.first_vertex; vertex < atlas_chart.chart.first_vertex + atlas_chart.chart.vertex_count; vertex++) {
+            glm::vec2 texel = glm::vec2(atlas_chart.position + glm::ivec2(1, 1)) + (vertex_data[vertex].lightmap_coordinates * glm::vec2(atlas_chart.size));
+            vertex_data[vertex].lightmap_coordinates = texel / glm::vec2(lightmap_size);
+        }
+
+        for (unsigned int row = 0; row < (unsigned int)atlas_chart.size.y + 2; row++) {
+            lightmap_rows.push_back({
+                .chart = i,
+                .row = row
+            });
+        }
+    }
+}
+
+// the same ambient, diffuse and attenuation that texture_fragment.glsl used for point lights
+float lightmap_light(const LightmapChart& chart, glm::vec3 position) {
+    glm::vec3 shadow_origin = position + (chart.normal * LIGHTMAP_SHADOW_OFFSET);
+    float light = 0.0f;
+    for (const PointLight& point_light : lights) {
+        glm::vec3 light_offset = point_light.position - position;
+        float light_distance = std::max(glm::length(light_offset), 0.0001f);
+        float attenuation = 1.0f / (point_light.constant + (point_light.linear * light_distance) + (point_light.quadratic * light_distance * light_distance));
+
+        // the ambient part isn't shadowed, so walls between a light and a texel only take away the diffuse part
+        float diffuse = std::max(glm::dot(chart.normal, light_offset / light_distance), 0.0f);
+        if (diffuse > 0.0f && raycast_is_occluded(shadow_origin, point_light.position)) {
+            diffuse = 0.0f;
+        }
+
+        light += (0.1f + diffuse) * attenuation;
+    }
+
+    return light;
+}
+
+void lightmap_bake_row(const LightmapRow& lightmap_row) {
+    const LightmapAtlasChart& atlas_chart = lightmap_charts[lightmap_row.chart];
+    // the border texels take the position of the edge texel next to them
+    int y = std::min(std::max((int)lightmap_row.row - 1, 0), atlas_chart.size.y - 1);
+    float t = (y + 0.5f) / atlas_chart.size.y;
+    float* texels = &lightmap_texels[((atlas_chart.position.y + lightmap_row.row) * lightmap_size.x) + atlas_chart.position.x];
+    for (int x = 0; x < atlas_chart.size.x + 2; x++) {
+        float s = (std::min(std::max(x - 1, 0), atlas_chart.size.x - 1) + 0.5f) / atlas_chart.size.x;
+        glm::vec3 position = atlas_chart.chart.origin + (atlas_chart.chart.u_axis * s) + (atlas_chart.chart.v_axis * t);
+        texels[x] = lightmap_light(atlas_chart.chart, position);
+    }
+}
+
+// rows are handed out one at a time, a chart's cost depends on how many lights reach it so even splits wouldn't be even
+void lightmap_bake_worker(std::atomic<unsigned int>* next_row) {
+    unsigned int row;
+    while ((row = next_row->fetch_add(1)) < lightmap_rows.size()) {
+        lightmap_bake_row(lightmap_rows[row]);
+    }
+}
+
+void lightmap_bake() {
+    ProfileScope profile_scope("lightmap_bake");
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    lightmap_texels.assign(lightmap_size.x * lightmap_size.y, 0.0f);
+
+    std::atomic<unsigned int> next_row(0);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < lightmap_thread_count; i++) {
+        threads.push_back(std::thread(lightmap_bake_worker, &next_row));
+    }
+    lightmap_bake_worker(&next_row);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (trace_loading) {
+        unsigned long texel_count = 0;
+        for (const LightmapAtlasChart& atlas_chart : lightmap_charts) {
+            texel_count += (atlas_chart.size.x + 2) * (atlas_chart.size.y + 2);
+        }
+        float bake_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        printf("Baked %lu lightmap texels for %u lights into a %ix%i atlas in %.2f ms on %u threads\n",
+               texel_count, (unsigned int)lights.size(), lightmap_size.x, lightmap_size.y, bake_time, std::max(1u, lightmap_thread_count));
+    }
+}
+
+void lightmap_upload() {
+    if (lightmap_texture == 0) {
+        glGenTextures(1, &lightmap_texture);
+    }
+    glBindTexture(GL_TEXTURE_2D, lightmap_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // sums of lights can go past 1, so the texels stay floats
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, lightmap_size.x, lightmap_size.y, 0, GL_RED, GL_FLOAT, lightmap_texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the layout is redone before every bake, so nothing is kept on the CPU
+    std::vector<float>().swap(lightmap_texels);
+    std::vector<LightmapRow>().swap(lightmap_rows);
+    lightmap_charts.clear();
+}
+
+void lightmap_bind(unsigned int texture_unit) {
+    glActiveTexture(GL_TEXTURE0 + texture_unit);
+    glBindTexture(GL_TEXTURE_2D, lightmap_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "level.hpp"
+
+#include <vector>
+
+// the level's point lights never move, so what they add is baked once into a lightmap atlas when the level loads
+// and the level shader only lights the flashlight per fragment
+// the specular part depends on the view and isn't baked, the diffuse part is shadowed by the raycast planes
+
+// how many texels a chart gets per world unit, big faces get fewer so that no chart is wider than the atlas
+const float LIGHTMAP_TEXELS_PER_UNIT = 4.0f;
+const unsigned int LIGHTMAP_WIDTH = 1024;
+const unsigned int LIGHTMAP_MAX_CHART_SIZE = 256;
+
+extern unsigned int lightmap_texture;
+// the bake splits its rows between this many threads, the calling one included
+extern unsigned int lightmap_thread_count;
+
+// gives every chart a rectangle in the atlas and moves its vertices' lightmap coordinates from chart space into atlas space
+// doesn't touch GL or raycast_planes, so it can run before the meshes are uploaded
+void lightmap_layout(std::vector<SectorMesh>* meshes);
+// needs raycast_planes to hold the whole level
+void lightmap_bake();
+// needs the GL context
+void lightmap_upload();
+void lightmap_bind(unsigned int texture_unit);
@@ -11,6 +11,20 @@
 #include "font.hpp"
 #include "scene.hpp"
 #include "resource.hpp"
+#include "raycast.hpp"
+#include "task.hpp"
+#include "pick.hpp"
+#include "undo.hpp"
+#include "pacer.hpp"
+#include "frame.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "replay.hpp"
+#include "bench.hpp"
+#include "arena.hpp"
+#include "model.hpp"
+#include "pack.hpp"
+#include "lightmap.hpp"
 
 #include <glad/glad.h>
 #include <SDL2/SDL.h>
@@ -20,10 +34,15 @@
 #include <ctime>
 
 #include <cstdio>
+#include <cstring>
 #include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 bool edit_mode;
+bool headless;
+bool trace_loading;
 unsigned int quad_vao;
 
 SDL_Window* window;
@@ -32,34 +51,258 @@ SDL_GLContext context;
 unsigned int WINDOW_WIDTH;
 unsigned int WINDOW_HEIGHT;
 
-const unsigned long FRAME_TIME = 1000.0 / 60.0;
-unsigned long last_time = SDL_GetTicks();
-unsigned long last_second = SDL_GetTicks();
+unsigned long last_second = 0;
 unsigned int frames = 0;
 unsigned int fps = 0;
+// F3 turns the profiler on and off, F4 writes its trace, F5 toggles the render stats
+const char* PROFILE_TRACE_PATH = "./profile.json";
+const char* BENCH_REPORT_PATH = "./bench.json";
 float elapsed = 0.0f;
 float screen_anim_timer = 0.0f;
 
+// file reads, decoding, map parsing and sector triangulation run as tasks,
+// everything that needs the GL context happens here on the main thread as their results come in
+bool startup_load(std::string level_path) {
+    bool success = true;
+    std::vector<unsigned int> pending_tasks;
+
+    bool shaders_read = false;
+    unsigned int shader_task = task_submit("read shaders", [&shaders_read]() {
+        shaders_read = shader_read_all();
+    });
+    // which textures to load depends on what's in the level, so they start once it's parsed
+    std::vector<unsigned int> resource_tasks;
+    std::vector<ResourceHandle> resource_handles;
+    unsigned int font_task = task_submit("decode font", font_load);
+    pending_tasks.push_back(font_task);
+    unsigned int level_task = task_submit("parse level", [level_path]() {
+        level_load(level_path);
+    });
+    pending_tasks.push_back(level_task);
+
+    // everything else uses the shaders, so they go first
+    task_wait(shader_task);
+    success = shaders_read;
+    if (success) {
+        task_run_here("compile shaders", [&success]() {
+            success = shader_compile_all();
+        });
+    }
+    task_run_here("generate texture names", resource_generate_names);
+
+    std::vector<SectorMesh> sector_meshes;
+    std::vector<unsigned int> sector_tasks;
+    while (!pending_tasks.empty()) {
+        unsigned int task = task_wait_any(&pending_tasks);
+        if (task == level_task) {
+            std::vector<ResourceHandle> level_resources;
+            if (edit_mode) {
+                edit_scene_resources(&level_resources);
+            } else {
+                scene_resources(&level_resources);
+            }
+            for (ResourceHandle handle : level_resources) {
+                resource_handles.push_back(handle);
+                resource_tasks.push_back(task_submit("decode texture " + std::to_string(handle), [handle]() {
+                    resource_decode(handle);
+                }));
+                pending_tasks.push_back(resource_tasks.back());
+            }
+
+            sector_meshes.resize(sectors.size());
+            for (unsigned int i = 0; i < sectors.size(); i++) {
+                sector_tasks.push_back(task_submit("build sector " + std::to_string(i), [i, &sector_meshes]() {
+                    sectors[i].build_mesh(i, &sector_meshes[i]);
+                }));
+            }
+        } else if (task == font_task && success) {
+            task_run_here("upload font", font_init);
+        }
+        for (unsigned int i = 0; i < resource_tasks.size(); i++) {
+            if (task == resource_tasks[i] && success) {
+                ResourceHandle handle = resource_handles[i];
+                task_run_here("upload texture " + std::to_string(handle), [handle, &success]() {
+                    success = resource_upload(handle);
+                });
+            }
+        }
+    }
+
+    // sectors are uploaded in order so that buffer names and raycast planes match the serial path
+    if (success) {
+        task_run_here("init level lighting", level_init_lighting);
+    }
+    // the lightmap atlas is laid out over every sector's charts, so all of them have to be built before any is uploaded
+    for (unsigned int i = 0; i < sector_tasks.size(); i++) {
+        task_wait(sector_tasks[i]);
+    }
+    task_run_here("lay out lightmap", [&sector_meshes]() {
+        lightmap_layout(&sector_meshes);
+    });
+    raycast_planes.clear();
+    for (unsigned int i = 0; i < sector_tasks.size(); i++) {
+        if (success) {
+            task_run_here("upload sector " + std::to_string(i), [i, &sector_meshes]() {
+                sectors[i].upload_mesh(sector_meshes[i]);
+            });
+        }
+    }
+    // the editor starts out unlit and bakes once lighting is turned on
+    if (success && !edit_mode) {
+        task_run_here("bake lightmap", lightmap_bake);
+        task_run_here("upload lightmap", lightmap_upload);
+    }
+
+    return success;
+}
+
 int main(int argc, char** argv) {
     edit_mode = false;
+    headless = false;
+    unsigned int headless_ticks = 0;
     std::string level_path = "";
+    unsigned int thread_count = std::max(1u, std::thread::hardware_concurrency());
+    trace_loading = false;
+    bool frame_stats = false;
+    bool check_render_rates = false;
+    std::string stats_log_path = "";
+    std::string record_path = "";
+    std::string replay_path = "";
+    std::string bench_path = "";
+    bool allocation_test = false;
+    bool use_pack = true;
+    unsigned int allocation_test_warmup = 120;
     for (int i = 0; i < argc; i++) {
         std::string arg = std::string(argv[i]);
         if (arg == "--edit") {
             edit_mode = true;
         } else if (arg.find("--level") != std::string::npos) {
             level_path = arg.substr(arg.find("=") + 1);
+        } else if (arg.find("--threads") != std::string::npos) {
+            thread_count = std::stoul(arg.substr(arg.find("=") + 1));
+        } else if (arg == "--trace-startup") {
+            trace_loading = true;
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg.find("--ticks") != std::string::npos) {
+            headless_ticks = std::stoul(arg.substr(arg.find("=") + 1));
+        } else if (arg == "--profile") {
+            profile_enabled = true;
+        } else if (arg.find("--stats-log") != std::string::npos) {
+            stats_log_path = arg.substr(arg.find("=") + 1);
+        } else if (arg.find("--record") != std::string::npos) {
+            record_path = arg.substr(arg.find("=") + 1);
+        } else if (arg.find("--replay") != std::string::npos) {
+            replay_path = arg.substr(arg.find("=") + 1);
+        } else if (arg.find("--alloc-test") != std::string::npos) {
+            allocation_test = true;
+            if (arg.find("=") != std::string::npos) {
+                allocation_test_warmup = std::stoul(arg.substr(arg.find("=") + 1));
+            }
+        } else if (arg == "--no-pack") {
+            use_pack = false;
+        } else if (arg.find("--pack=") != std::string::npos) {
+            return pack_build(arg.substr(arg.find("=") + 1)) ? 0 : 1;
+        } else if (arg == "--check-render-rates") {
+            check_render_rates = true;
+        } else if (arg == "--frame-stats") {
+            frame_stats = true;
+        } else if (arg.find("--bench=") != std::string::npos) {
+            bench_path = arg.substr(arg.find("=") + 1);
+        } else if (arg.find("--bench-pick") != std::string::npos) {
+            pick_benchmark(std::stoul(arg.substr(arg.find("=") + 1)));
+            return 0;
+        } else if (arg.find("--bench-undo") != std::string::npos) {
+            undo_benchmark(std::stoul(arg.substr(arg.find("=") + 1)));
+            return 0;
+        } else if (arg.find("--bench-obj=") != std::string::npos) {
+            model_benchmark(arg.substr(arg.find("=") + 1));
+            return 0;
+        } else if (arg.find("--bench-draco=") != std::string::npos) {
+            model_draco_benchmark(arg.substr(arg.find("=") + 1));
+            return 0;
+        } else if (arg.find("--convert-draco=") != std::string::npos) {
+            return model_convert_draco(arg.substr(arg.find("=") + 1)) ? 0 : 1;
         }
     }
     if (level_path == "") {
         level_path = "./map/test.map";
     }
 
+    // the editor saves maps as loose files, so it has to read them that way too
+    if (use_pack && !edit_mode) {
+        pack_open(PACK_PATH);
+    }
     if (!config_init()) {
         return -1;
     }
 
-    srand(time(NULL));
+    if (stats_log_path == "") {
+        stats_log_path = stats_log;
+    }
+    if (!stats_init(stats_log_path, stats_log_interval_seconds)) {
+        return -1;
+    }
+    // fails the run if any frame after the warm-up allocates, pair it with --replay or --bench for a repeatable session
+    if (allocation_test) {
+        profile_track_scopes = true;
+        stats_track_allocations(allocation_test_warmup);
+    }
+
+    // a replay brings its own seed and level, and runs uncapped one tick a frame as a benchmark
+    unsigned int seed = time(NULL);
+    if (replay_path != "") {
+        if (!replay_play_begin(replay_path, &seed, &level_path)) {
+            return -1;
+        }
+        frame_pacing = PACER_UNCAPPED;
+        frame_stats = true;
+    } else if (record_path != "" && !edit_mode) {
+        if (!replay_record_begin(record_path, seed, level_path)) {
+            return -1;
+        }
+    }
+    srand(seed);
+
+    // the bench measures whole frames, so the capture runs on the main thread and nothing waits between frames
+    bool bench = bench_path != "" && !edit_mode;
+    if (bench) {
+        if (headless) {
+            printf("The bench draws every frame, it can't run headless\n");
+            return -1;
+        }
+        frame_pacing = PACER_UNCAPPED;
+        pipelined_simulation = false;
+    }
+
+    // no SDL or GL at all, so this runs on machines without a GPU or a display
+    if (headless) {
+        if (replay_mode == REPLAY_PLAY && (headless_ticks == 0 || headless_ticks > replay_tick_count())) {
+            headless_ticks = replay_tick_count();
+        } else if (headless_ticks == 0) {
+            headless_ticks = tick_rate * 60;
+        }
+        profile_init(false);
+        // fails the run if the frame rate changes what the simulation does
+        if (check_render_rates) {
+            bool rates_match = scene_check_render_rates(level_path, seed, headless_ticks);
+            stats_quit();
+            replay_end();
+            return rates_match ? 0 : 1;
+        }
+        level_init(level_path);
+        scene_init();
+        scene_run_headless(headless_ticks);
+        if (profile_enabled) {
+            profile_export_trace(PROFILE_TRACE_PATH);
+        }
+        stats_quit();
+        replay_end();
+        if (allocation_test && !stats_allocation_report()) {
+            return 1;
+        }
+        return 0;
+    }
 
     // Init engine
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -87,6 +330,7 @@ int main(int argc, char** argv) {
     }
 
     gladLoadGLLoader(SDL_GL_GetProcAddress);
+    stats_hook_gl();
     printf("Initialized OpenGL. Vendor %s\nRenderer %s\nVersion%s\n", glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION));
 
     if (glGenVertexArrays == NULL) {
@@ -100,20 +344,31 @@ int main(int argc, char** argv) {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
 
-    if (!shader_compile_all()) {
-        return -1;
+    profile_init(true);
+
+    task_init(thread_count);
+    lightmap_thread_count = thread_count;
+    bool startup_success = startup_load(level_path);
+    task_quit();
+    if (trace_loading) {
+        task_trace_print();
     }
-    if (!resource_load_all()) {
+    if (!startup_success) {
         return -1;
     }
 
-    font_init();
     input_set_mapping();
-    level_init(level_path);
     if (edit_mode) {
         edit_scene_init();
     } else {
         scene_init();
+        scene_init_render();
+        if (bench && !bench_init(bench_path)) {
+            return -1;
+        }
+    }
+    if (trace_loading) {
+        resource_print_residency();
     }
 
     glUseProgram(screen_shader);
@@ -184,29 +439,47 @@ int main(int argc, char** argv) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // Game loop
+    if (!edit_mode) {
+        frame_init(pipelined_simulation);
+    }
+    pacer_init(frame_pacing, max_fps);
+    last_second = SDL_GetTicks();
     bool running = true;
     while (running) {
+        ProfileScope frame_scope("frame");
+        arena_reset();
+
         // Timekeep
-        unsigned long current_time = SDL_GetTicks();
-        if (current_time - last_time < FRAME_TIME) {
-            continue;
+        float frame_time = pacer_wait();
+        if (replay_mode == REPLAY_PLAY) {
+            frame_time = 1000.0f / tick_rate;
+        } else if (bench) {
+            // no ticks, the camera is the only thing that moves
+            frame_time = 0.0f;
         }
+        float delta = frame_time / 60.0f;
 
-        float delta = (float)(current_time - last_time) / 60.0f;
-        last_time = current_time;
-
+        unsigned long current_time = SDL_GetTicks();
         if (current_time - last_second >= 1000) {
             fps = frames;
             frames = 0;
             last_second += 1000;
         }
 
-        // Handle input
-        input_prime_state();
+        // Handle input, in game the simulation ticks clear it once they've used it
+        if (edit_mode) {
+            input_prime_state();
+        }
         SDL_Event e;
         while (SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT || (edit_mode && e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE)) {
                 running = false;
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3) {
+                profile_enabled = !profile_enabled;
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4) {
+                profile_export_trace(PROFILE_TRACE_PATH);
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F5) {
+                show_render_stats = !show_render_stats;
             } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
                 if (SDL_GetRelativeMouseMode() == SDL_TRUE) {
                     SDL_SetRelativeMouseMode(SDL_FALSE);
@@ -217,6 +490,9 @@ int main(int argc, char** argv) {
                 SDL_SetRelativeMouseMode(SDL_TRUE);
             } else if (SDL_GetRelativeMouseMode() == SDL_TRUE || edit_mode) {
                 input_handle_event(e);
+                if (edit_mode) {
+                    edit_request_redraw();
+                }
             }
         }
 
@@ -227,11 +503,17 @@ int main(int argc, char** argv) {
             } else {
                 edit_update();
             }
-        } else {
-            scene_update(delta);
+        }
+        // the next frame is simulated while this one renders the last
+        if (bench) {
+            bench_frame_begin();
+        }
+        if (!edit_mode) {
+            frame_begin(frame_time);
         }
 
         // Render onto framebuffer
+        profile_gpu_begin("scene pass");
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
         glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
         glBlendFunc(GL_ONE, GL_ZERO);
@@ -240,13 +522,14 @@ int main(int argc, char** argv) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         if (edit_mode) {
-            edit_render();
             edit_scene_render();
         } else {
-            scene_render();
+            scene_render(frame_current());
         }
+        font_flush();
 
         // Render framebuffer to screen
+        profile_gpu_begin("screen pass");
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
         glBlendFunc(GL_ONE, GL_ZERO);
@@ -255,25 +538,75 @@ int main(int argc, char** argv) {
         glClear(GL_COLOR_BUFFER_BIT);
 
         glUseProgram(screen_shader);
-        glUniform1f(glGetUniformLocation(screen_shader, "elapsed"), elapsed);
-        glUniform1f(glGetUniformLocation(screen_shader, "time"), screen_anim_timer);
+        if (edit_mode) {
+            glUniform1f(glGetUniformLocation(screen_shader, "elapsed"), elapsed);
+            glUniform1f(glGetUniformLocation(screen_shader, "time"), screen_anim_timer);
+        } else {
+            glUniform1f(glGetUniformLocation(screen_shader, "elapsed"), frame_current().elapsed);
+            glUniform1f(glGetUniformLocation(screen_shader, "time"), frame_current().screen_anim_timer);
+        }
         glBindVertexArray(quad_vao);
         glBindTexture(GL_TEXTURE_2D, texture_color_buffer);
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
 
         // Render fps
+        profile_gpu_begin("text");
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        std::string fps_text = "FPS " + std::to_string(fps);
-        font_hack_10pt.render_text(fps_text, SCREEN_WIDTH - (fps_text.length() * 10.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+        const char* fps_text = arena_printf("FPS %u", fps);
+        font_hack_10pt.render_text(fps_text, SCREEN_WIDTH - (strlen(fps_text) * 10.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+        if (show_render_stats) {
+            const CullStats& stats = edit_mode ? cull_stats : frame_current().cull_stats;
+            const char* sectors_text = arena_printf("SECTORS %u CULLED %u", stats.sectors_drawn, stats.sectors_culled);
+            font_hack_10pt.render_text(sectors_text, SCREEN_WIDTH - (strlen(sectors_text) * 10.0f), 10.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+            const char* billboards_text = arena_printf("SPRITES %u CULLED %u", stats.billboards_drawn, stats.billboards_culled);
+            font_hack_10pt.render_text(billboards_text, SCREEN_WIDTH - (strlen(billboards_text) * 10.0f), 20.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+            stats_render_overlay(30.0f);
+        }
+        if (profile_enabled) {
+            // below the player's health and ammo
+            profile_render_breakdown(0.0f, 30.0f);
+        }
+        font_flush();
+
+        profile_gpu_end();
+        if (bench) {
+            bench_frame_submitted();
+        }
 
         SDL_GL_SwapWindow(window);
 
         // Render edit window
         if (edit_mode) {
             edit_render();
+        } else {
+            frame_end();
         }
         frames++;
+        resource_collect();
+        profile_frame_end();
+        stats_frame_end(frame_time);
+        if (replay_finished() || (bench && !bench_frame_end())) {
+            running = false;
+        }
+    }
+    if (!edit_mode) {
+        frame_quit();
+    }
+    profile_quit();
+    stats_quit();
+    pack_close();
+    if (replay_mode == REPLAY_PLAY) {
+        printf("State checksum %08x\n", scene_checksum());
+    }
+    replay_end();
+    if (bench) {
+        bench_report(BENCH_REPORT_PATH);
+    }
+    bool allocation_test_passed = !allocation_test || stats_allocation_report();
+
+    if (frame_stats) {
+        pacer_print_stats();
     }
 
     // Quit everything
@@ -284,5 +617,5 @@ int main(int argc, char** argv) {
 
     SDL_Quit();
 
-    return 0;
+    return allocation_test_passed ? 0 : 1;
 }
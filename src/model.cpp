@@ -1,37 +1,468 @@
 #include "model.hpp"
 
+#include "file.hpp"
+
+#include <draco/compression/decode.h>
+#include <draco/compression/encode.h>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <fstream>
-#include <vector>
+#include <unordered_map>
+
+// indices into the position, uv and normal lists, uvs and normals can be left out
+struct ModelCorner {
+    unsigned int position;
+    unsigned int texture_coordinates;
+    unsigned int normal;
 
-struct Face {
-    unsigned int position_indices[3];
-    unsigned int texture_coordinate_indices[3];
-    unsigned int normal_indices[3];
+    bool operator==(const ModelCorner& other) const {
+        return position == other.position && texture_coordinates == other.texture_coordinates && normal == other.normal;
+    }
 };
 
-struct ModelVertexData {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texture_coordinates;
+struct ModelCornerHash {
+    size_t operator()(const ModelCorner& corner) const {
+        return file_hash(&corner, sizeof(corner));
+    }
 };
 
+const unsigned int MODEL_NO_INDEX = 0xFFFFFFFF;
+
+// bits per component once quantized, more than the draco tool defaults since models are seen up close
+const int MODEL_DRACO_POSITION_BITS = 14;
+const int MODEL_DRACO_NORMAL_BITS = 10;
+const int MODEL_DRACO_TEXTURE_COORDINATE_BITS = 12;
+
 Model::Model() { }
 
-void Model::open(std::string path) {
-    std::ifstream filein(path.c_str());
+bool Model::open(std::string path) {
+    ModelMesh mesh;
+    if (!model_parse(path, &mesh)) {
+        return false;
+    }
+    upload(mesh);
+    return true;
+}
+
+void Model::upload(const ModelMesh& mesh) {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(ModelVertexData), mesh.vertices.data(), GL_STATIC_DRAW);
+    // the element buffer binding is part of the VAO, so it stays bound
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertexData), (void*)0);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertexData), (void*)(3 * sizeof(float)));
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertexData), (void*)(6 * sizeof(float)));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    index_count = mesh.indices.size();
+}
+
+void Model::render(unsigned int shader, glm::vec3 position) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, position);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+    glBindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, (void*)0);
+    glBindVertexArray(0);
+}
+
+void model_skip_spaces(const char** cursor, const char* end) {
+    while (*cursor < end && (**cursor == ' ' || **cursor == '\t')) {
+        (*cursor)++;
+    }
+}
+
+void model_skip_line(const char** cursor, const char* end) {
+    while (*cursor < end && **cursor != '\n') {
+        (*cursor)++;
+    }
+    if (*cursor < end) {
+        (*cursor)++;
+    }
+}
+
+// the mapped file isn't null terminated, so strtof can't be trusted not to read past the end
+bool model_parse_float(const char** cursor, const char* end, float* value) {
+    model_skip_spaces(cursor, end);
+    const char* c = *cursor;
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+
+    // digits past what fits in the mantissa only move the exponent
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    unsigned int digits = 0;
+    for (; c < end && *c >= '0' && *c <= '9'; c++, digits++) {
+        if (mantissa < 1000000000000000000ULL) {
+            mantissa = (mantissa * 10) + (*c - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (c < end && *c == '.') {
+        c++;
+        for (; c < end && *c >= '0' && *c <= '9'; c++, digits++) {
+            if (mantissa < 1000000000000000000ULL) {
+                mantissa = (mantissa * 10) + (*c - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        c++;
+        bool exponent_negative = false;
+        if (c < end && (*c == '-' || *c == '+')) {
+            exponent_negative = *c == '-';
+            c++;
+        }
+        int written_exponent = 0;
+        for (; c < end && *c >= '0' && *c <= '9'; c++) {
+            written_exponent = std::min((written_exponent * 10) + (*c - '0'), 1000);
+        }
+        exponent += exponent_negative ? -written_exponent : written_exponent;
+    }
+
+    double result = (double)mantissa;
+    if (exponent != 0) {
+        result = exponent < 0 ? result / std::pow(10.0, -exponent) : result * std::pow(10.0, exponent);
+    }
+    *value = (float)(negative ? -result : result);
+    *cursor = c;
+    return true;
+}
+
+bool model_parse_int(const char** cursor, const char* end, int* value) {
+    const char* c = *cursor;
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+    if (c == end || *c < '0' || *c > '9') {
+        return false;
+    }
+
+    int result = 0;
+    for (; c < end && *c >= '0' && *c <= '9'; c++) {
+        result = (result * 10) + (*c - '0');
+    }
+    *value = negative ? -result : result;
+    *cursor = c;
+    return true;
+}
+
+// obj indices start at 1, and negative ones count back from the end of what's been read so far
+bool model_resolve_index(int index, size_t count, unsigned int* resolved) {
+    if (index > 0) {
+        *resolved = index - 1;
+        return true;
+    }
+    if (index < 0 && (size_t)-index <= count) {
+        *resolved = count + index;
+        return true;
+    }
+    return false;
+}
+
+bool model_parse_obj(const std::string& path, ModelMesh* mesh) {
+    MappedFile file;
+    if (!file_map(path, &file)) {
+        printf("Unable to open model %s\n", path.c_str());
+        return false;
+    }
 
     std::vector<glm::vec3> positions;
     std::vector<glm::vec2> texture_coordinates;
     std::vector<glm::vec3> normals;
-    std::vector<Face> faces;
+    std::vector<ModelCorner> corners;
+    std::unordered_map<ModelCorner, unsigned int, ModelCornerHash> corner_indices;
+    mesh->indices.clear();
+
+    const char* cursor = (const char*)file.data;
+    const char* end = cursor + file.size;
+    unsigned int line_number = 0;
+    bool success = true;
+    while (cursor < end && success) {
+        line_number++;
+        model_skip_spaces(&cursor, end);
+        const char* keyword = cursor;
+        while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\n' && *cursor != '\r') {
+            cursor++;
+        }
+        size_t keyword_length = cursor - keyword;
+
+        if (keyword_length == 1 && keyword[0] == 'v') {
+            glm::vec3 position;
+            success = model_parse_float(&cursor, end, &position.x) && model_parse_float(&cursor, end, &position.y) && model_parse_float(&cursor, end, &position.z);
+            positions.push_back(position);
+        } else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+            glm::vec2 uv;
+            success = model_parse_float(&cursor, end, &uv.x) && model_parse_float(&cursor, end, &uv.y);
+            texture_coordinates.push_back(uv);
+        } else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+            glm::vec3 normal;
+            success = model_parse_float(&cursor, end, &normal.x) && model_parse_float(&cursor, end, &normal.y) && model_parse_float(&cursor, end, &normal.z);
+            normals.push_back(normal);
+        } else if (keyword_length == 1 && keyword[0] == 'f') {
+            // triangulated as a fan around the first vertex
+            unsigned int face_vertices = 0;
+            unsigned int first_index = 0;
+            unsigned int previous_index = 0;
+            while (success) {
+                model_skip_spaces(&cursor, end);
+                int position = 0;
+                if (!model_parse_int(&cursor, end, &position)) {
+                    break;
+                }
+
+                ModelCorner corner = { .position = 0, .texture_coordinates = MODEL_NO_INDEX, .normal = MODEL_NO_INDEX };
+                success = model_resolve_index(position, positions.size(), &corner.position);
+                int index;
+                if (cursor < end && *cursor == '/') {
+                    cursor++;
+                    if (model_parse_int(&cursor, end, &index)) {
+                        success = success && model_resolve_index(index, texture_coordinates.size(), &corner.texture_coordinates);
+                    }
+                    if (cursor < end && *cursor == '/') {
+                        cursor++;
+                        if (model_parse_int(&cursor, end, &index)) {
+                            success = success && model_resolve_index(index, normals.size(), &corner.normal);
+                        }
+                    }
+                }
+
+                std::pair<std::unordered_map<ModelCorner, unsigned int, ModelCornerHash>::iterator, bool> inserted = corner_indices.insert({ corner, (unsigned int)corners.size() });
+                if (inserted.second) {
+                    corners.push_back(corner);
+                }
+                unsigned int vertex_index = inserted.first->second;
+
+                if (face_vertices == 0) {
+                    first_index = vertex_index;
+                } else if (face_vertices >= 2) {
+                    mesh->indices.push_back(first_index);
+                    mesh->indices.push_back(previous_index);
+                    mesh->indices.push_back(vertex_index);
+                }
+                previous_index = vertex_index;
+                face_vertices++;
+            }
+            success = success && face_vertices >= 3;
+        }
+
+        if (!success) {
+            printf("Bad %.*s on line %u of model %s\n", (int)keyword_length, keyword, line_number, path.c_str());
+        }
+        model_skip_line(&cursor, end);
+    }
+    file_unmap(&file);
+    if (!success) {
+        return false;
+    }
 
+    // faces can name elements that come later in the file, so the bounds are only known now
+    mesh->vertices.resize(corners.size());
+    for (unsigned int i = 0; i < corners.size(); i++) {
+        const ModelCorner& corner = corners[i];
+        if (corner.position >= positions.size() ||
+            (corner.texture_coordinates != MODEL_NO_INDEX && corner.texture_coordinates >= texture_coordinates.size()) ||
+            (corner.normal != MODEL_NO_INDEX && corner.normal >= normals.size())) {
+            printf("Model %s has a face with an index past the end of its list\n", path.c_str());
+            return false;
+        }
+
+        mesh->vertices[i] = {
+            .position = positions[corner.position],
+            .normal = corner.normal == MODEL_NO_INDEX ? glm::vec3(0.0f, 0.0f, 0.0f) : normals[corner.normal],
+            .texture_coordinates = corner.texture_coordinates == MODEL_NO_INDEX ? glm::vec2(0.0f, 0.0f) : texture_coordinates[corner.texture_coordinates]
+        };
+    }
+
+    return true;
+}
+
+bool model_parse(const std::string& path, ModelMesh* mesh) {
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".drc") == 0) {
+        return model_parse_draco(path, mesh);
+    }
+    return model_parse_obj(path, mesh);
+}
+
+bool model_decode_draco(const unsigned char* data, size_t size, const std::string& path, ModelMesh* mesh) {
+    draco::DecoderBuffer buffer;
+    buffer.Init((const char*)data, size);
+    draco::Decoder decoder;
+    draco::StatusOr<std::unique_ptr<draco::Mesh>> decoded = decoder.DecodeMeshFromBuffer(&buffer);
+    if (!decoded.ok()) {
+        printf("Unable to decode model %s! Draco Error: %s\n", path.c_str(), decoded.status().error_msg());
+        return false;
+    }
+    const draco::Mesh& draco_mesh = *decoded.value();
+
+    const draco::PointAttribute* position_attribute = draco_mesh.GetNamedAttribute(draco::GeometryAttribute::POSITION);
+    const draco::PointAttribute* normal_attribute = draco_mesh.GetNamedAttribute(draco::GeometryAttribute::NORMAL);
+    const draco::PointAttribute* texture_coordinate_attribute = draco_mesh.GetNamedAttribute(draco::GeometryAttribute::TEX_COORD);
+    if (position_attribute == nullptr) {
+        printf("Model %s has no positions\n", path.c_str());
+        return false;
+    }
+
+    // draco points are already one per distinct attribute combination, so they map straight onto vertices
+    mesh->vertices.resize(draco_mesh.num_points());
+    for (unsigned int i = 0; i < draco_mesh.num_points(); i++) {
+        draco::PointIndex point(i);
+        ModelVertexData& vertex = mesh->vertices[i];
+        vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+        vertex.texture_coordinates = glm::vec2(0.0f, 0.0f);
+        position_attribute->ConvertValue<float, 3>(position_attribute->mapped_index(point), &vertex.position.x);
+        if (normal_attribute != nullptr) {
+            normal_attribute->ConvertValue<float, 3>(normal_attribute->mapped_index(point), &vertex.normal.x);
+        }
+        if (texture_coordinate_attribute != nullptr) {
+            texture_coordinate_attribute->ConvertValue<float, 2>(texture_coordinate_attribute->mapped_index(point), &vertex.texture_coordinates.x);
+        }
+    }
+
+    mesh->indices.resize(draco_mesh.num_faces() * 3);
+    for (unsigned int i = 0; i < draco_mesh.num_faces(); i++) {
+        const draco::Mesh::Face& face = draco_mesh.face(draco::FaceIndex(i));
+        mesh->indices[(i * 3) + 0] = face[0].value();
+        mesh->indices[(i * 3) + 1] = face[1].value();
+        mesh->indices[(i * 3) + 2] = face[2].value();
+    }
+
+    return true;
+}
+
+bool model_parse_draco(const std::string& path, ModelMesh* mesh) {
+    MappedFile file;
+    if (!file_map(path, &file)) {
+        printf("Unable to open model %s\n", path.c_str());
+        return false;
+    }
+    bool success = model_decode_draco(file.data, file.size, path, mesh);
+    file_unmap(&file);
+    return success;
+}
+
+int model_add_draco_attribute(draco::Mesh* draco_mesh, draco::GeometryAttribute::Type type, unsigned int components) {
+    draco::GeometryAttribute attribute;
+    attribute.Init(type, nullptr, components, draco::DT_FLOAT32, false, sizeof(float) * components, 0);
+    return draco_mesh->AddAttribute(attribute, true, draco_mesh->num_points());
+}
+
+bool model_encode_draco(const ModelMesh& mesh, std::vector<unsigned char>* data) {
+    draco::Mesh draco_mesh;
+    draco_mesh.set_num_points(mesh.vertices.size());
+    draco::PointAttribute* position_attribute = draco_mesh.attribute(model_add_draco_attribute(&draco_mesh, draco::GeometryAttribute::POSITION, 3));
+    draco::PointAttribute* normal_attribute = draco_mesh.attribute(model_add_draco_attribute(&draco_mesh, draco::GeometryAttribute::NORMAL, 3));
+    draco::PointAttribute* texture_coordinate_attribute = draco_mesh.attribute(model_add_draco_attribute(&draco_mesh, draco::GeometryAttribute::TEX_COORD, 2));
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+        draco::AttributeValueIndex value(i);
+        position_attribute->SetAttributeValue(value, &mesh.vertices[i].position.x);
+        normal_attribute->SetAttributeValue(value, &mesh.vertices[i].normal.x);
+        texture_coordinate_attribute->SetAttributeValue(value, &mesh.vertices[i].texture_coordinates.x);
+    }
+
+    draco_mesh.SetNumFaces(mesh.indices.size() / 3);
+    for (unsigned int i = 0; i < mesh.indices.size() / 3; i++) {
+        draco::Mesh::Face face;
+        face[0] = draco::PointIndex(mesh.indices[(i * 3) + 0]);
+        face[1] = draco::PointIndex(mesh.indices[(i * 3) + 1]);
+        face[2] = draco::PointIndex(mesh.indices[(i * 3) + 2]);
+        draco_mesh.SetFace(draco::FaceIndex(i), face);
+    }
+
+    draco::Encoder encoder;
+    encoder.SetAttributeQuantization(draco::GeometryAttribute::POSITION, MODEL_DRACO_POSITION_BITS);
+    encoder.SetAttributeQuantization(draco::GeometryAttribute::NORMAL, MODEL_DRACO_NORMAL_BITS);
+    encoder.SetAttributeQuantization(draco::GeometryAttribute::TEX_COORD, MODEL_DRACO_TEXTURE_COORDINATE_BITS);
+    draco::EncoderBuffer buffer;
+    draco::Status status = encoder.EncodeMeshToBuffer(draco_mesh, &buffer);
+    if (!status.ok()) {
+        printf("Unable to encode model! Draco Error: %s\n", status.error_msg());
+        return false;
+    }
+
+    data->assign(buffer.data(), buffer.data() + buffer.size());
+    return true;
+}
+
+bool model_convert_draco(const std::string& path) {
+    ModelMesh mesh;
+    if (!model_parse_obj(path, &mesh)) {
+        return false;
+    }
+    std::vector<unsigned char> data;
+    if (!model_encode_draco(mesh, &data)) {
+        return false;
+    }
+
+    std::string draco_path = path.substr(0, path.find_last_of('.')) + ".drc";
+    if (!file_write_atomic(draco_path, data)) {
+        printf("Unable to write model %s\n", draco_path.c_str());
+        return false;
+    }
+    printf("Wrote %s, %u vertices and %u triangles in %u bytes\n", draco_path.c_str(), (unsigned int)mesh.vertices.size(), (unsigned int)mesh.indices.size() / 3, (unsigned int)data.size());
+    return true;
+}
+
+float model_elapsed_ms(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void model_benchmark(const std::string& path) {
+    MappedFile file;
+    if (!file_map(path, &file)) {
+        printf("Unable to open model %s\n", path.c_str());
+        return;
+    }
+    float megabytes = file.size / (1024.0f * 1024.0f);
+    file_unmap(&file);
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    ModelMesh mesh;
+    if (!model_parse_obj(path, &mesh)) {
+        return;
+    }
+    float parse_time = model_elapsed_ms(start_time);
+
+    // the old way, getline and splitting each line into strings, one vertex per face corner,
+    // only understands triangles with all three of v/vt/vn
+    start_time = std::chrono::steady_clock::now();
+    std::ifstream filein(path.c_str());
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texture_coordinates;
+    std::vector<glm::vec3> normals;
+    std::vector<ModelVertexData> vertex_data;
     for (std::string line; std::getline(filein, line);) {
-        if (line[0] == '#') {
+        if (line.empty() || line[0] == '#') {
             continue;
         }
         std::vector<std::string> words;
@@ -53,59 +484,79 @@ void Model::open(std::string path) {
         } else if (words[0] == "vn") {
             normals.push_back(glm::vec3(std::stof(words[1]), std::stof(words[2]), std::stof(words[3])));
         } else if (words[0] == "f") {
-            Face face;
             for (unsigned int i = 0; i < 3; i++) {
                 std::size_t slash_index = words[i + 1].find("/");
                 std::size_t second_slash_index = words[i + 1].find("/", slash_index + 1);
-                // subtract all indices by one because OBJ file indices start at 1 instead of 0
-                face.position_indices[i] = std::stoi(words[i + 1].substr(0, slash_index)) - 1;
-                face.texture_coordinate_indices[i] = std::stoi(words[i + 1].substr(slash_index + 1, second_slash_index)) - 1;
-                face.normal_indices[i] = std::stoi(words[i + 1].substr(second_slash_index + 1)) - 1;
+                vertex_data.push_back(ModelVertexData {
+                    .position = positions[std::stoi(words[i + 1].substr(0, slash_index)) - 1],
+                    .normal = normals[std::stoi(words[i + 1].substr(second_slash_index + 1)) - 1],
+                    .texture_coordinates = texture_coordinates[std::stoi(words[i + 1].substr(slash_index + 1, second_slash_index)) - 1]
+                });
             }
-            faces.push_back(face);
         }
     }
+    float old_parse_time = model_elapsed_ms(start_time);
 
-    std::vector<ModelVertexData> vertex_data;
-    for (Face face : faces) {
-        for (unsigned int i = 0; i < 3; i++) {
-            vertex_data.push_back(ModelVertexData {
-                .position = positions[face.position_indices[i]],
-                .normal = normals[face.normal_indices[i]],
-                .texture_coordinates = texture_coordinates[face.texture_coordinate_indices[i]]
-            });
-        }
-    }
-
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-    glBufferData(GL_ARRAY_BUFFER, vertex_data.size() * sizeof(ModelVertexData), &vertex_data[0], GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertexData), (void*)0);
+    size_t indexed_bytes = (mesh.vertices.size() * sizeof(ModelVertexData)) + (mesh.indices.size() * sizeof(unsigned int));
+    size_t old_bytes = vertex_data.size() * sizeof(ModelVertexData);
+    printf("Model benchmark, %s, %.2f MB\n", path.c_str(), megabytes);
+    printf("  parse      %10.2f ms  %8.1f MB/s\n", parse_time, megabytes / (parse_time / 1000.0f));
+    printf("  old parse  %10.2f ms  %8.1f MB/s\n", old_parse_time, megabytes / (old_parse_time / 1000.0f));
+    printf("  vertices   %10u unique, %u before indexing (%.1fx fewer)\n", (unsigned int)mesh.vertices.size(), (unsigned int)vertex_data.size(),
+        mesh.vertices.empty() ? 0.0f : (float)vertex_data.size() / mesh.vertices.size());
+    printf("  buffers    %10.2f MB with indices, %.2f MB before\n", indexed_bytes / (1024.0f * 1024.0f), old_bytes / (1024.0f * 1024.0f));
+}
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertexData), (void*)(3 * sizeof(float)));
+void model_draco_benchmark(const std::string& path) {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    ModelMesh obj_mesh;
+    if (!model_parse_obj(path, &obj_mesh)) {
+        return;
+    }
+    float obj_load_time = model_elapsed_ms(start_time);
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertexData), (void*)(6 * sizeof(float)));
+    std::vector<unsigned char> obj_data;
+    file_read(path, &obj_data);
+    start_time = std::chrono::steady_clock::now();
+    std::vector<unsigned char> draco_data;
+    if (!model_encode_draco(obj_mesh, &draco_data)) {
+        return;
+    }
+    float encode_time = model_elapsed_ms(start_time);
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // decode straight from memory, then again from disk so the load includes mapping the file
+    start_time = std::chrono::steady_clock::now();
+    ModelMesh draco_mesh;
+    if (!model_decode_draco(draco_data.data(), draco_data.size(), path, &draco_mesh)) {
+        return;
+    }
+    float decode_time = model_elapsed_ms(start_time);
 
-    vertex_data_size = vertex_data.size();
-}
+    std::string draco_path = path + ".bench.drc";
+    if (!file_write_atomic(draco_path, draco_data)) {
+        printf("Unable to write model %s\n", draco_path.c_str());
+        return;
+    }
+    start_time = std::chrono::steady_clock::now();
+    model_parse_draco(draco_path, &draco_mesh);
+    float draco_load_time = model_elapsed_ms(start_time);
+    std::remove(draco_path.c_str());
 
-void Model::render(unsigned int shader, glm::vec3 position) {
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, position);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glm::vec3 minimum = obj_mesh.vertices.empty() ? glm::vec3(0.0f) : obj_mesh.vertices[0].position;
+    glm::vec3 maximum = minimum;
+    for (const ModelVertexData& vertex : obj_mesh.vertices) {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+    }
+    // draco quantizes against the largest side of the bounds
+    glm::vec3 extent = maximum - minimum;
+    float position_step = std::max(extent.x, std::max(extent.y, extent.z)) / ((1 << MODEL_DRACO_POSITION_BITS) - 1);
 
-    glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, vertex_data_size);
-    glBindVertexArray(0);
+    printf("Draco benchmark, %s, %u vertices, %u triangles\n", path.c_str(), (unsigned int)obj_mesh.vertices.size(), (unsigned int)obj_mesh.indices.size() / 3);
+    printf("  size       %10.1f KB obj, %.1f KB draco (%.1fx smaller)\n", obj_data.size() / 1024.0f, draco_data.size() / 1024.0f,
+        draco_data.empty() ? 0.0f : (float)obj_data.size() / draco_data.size());
+    printf("  encode     %10.2f ms\n", encode_time);
+    printf("  decode     %10.2f ms from memory\n", decode_time);
+    printf("  load       %10.2f ms obj, %.2f ms draco, file to vertices and indices\n", obj_load_time, draco_load_time);
+    printf("  quantized  %10.6f position step, %u vertices and %u triangles after decoding\n", position_step, (unsigned int)draco_mesh.vertices.size(), (unsigned int)draco_mesh.indices.size() / 3);
 }
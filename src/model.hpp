@@ -2,14 +2,44 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
+
+struct ModelVertexData {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texture_coordinates;
+};
+
+// what parsing an OBJ produces, every distinct position/uv/normal triple is one vertex
+struct ModelMesh {
+    std::vector<ModelVertexData> vertices;
+    std::vector<unsigned int> indices;
+};
 
 struct Model {
     unsigned int vao;
     unsigned int vbo;
     unsigned int ebo;
-    unsigned int vertex_data_size;
+    unsigned int index_count;
 
     Model();
-    void open(std::string path);
+    // parse and upload, parsing doesn't touch GL so it can happen on another thread with upload called later
+    // .drc files are decoded as draco, anything else is read as OBJ
+    bool open(std::string path);
+    void upload(const ModelMesh& mesh);
     void render(unsigned int shader, glm::vec3 position);
-};
\ No newline at end of file
+};
+
+// single pass over the mapped file, faces with more than three vertices are split into fans
+// and negative indices count back from the last element read
+bool model_parse_obj(const std::string& path, ModelMesh* mesh);
+bool model_parse_draco(const std::string& path, ModelMesh* mesh);
+bool model_parse(const std::string& path, ModelMesh* mesh);
+// draco quantizes positions, normals and uvs, so a converted model is close to the OBJ but not bit for bit
+bool model_encode_draco(const ModelMesh& mesh, std::vector<unsigned char>* data);
+// writes next to the OBJ with the extension swapped for .drc
+bool model_convert_draco(const std::string& path);
+
+void model_benchmark(const std::string& path);
+// loads an OBJ both as it is and converted to draco
+void model_draco_benchmark(const std::string& path);
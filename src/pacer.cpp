@@ -0,0 +1,128 @@
+#include "pacer.hpp"
+
+#include "profile.hpp"
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+PacerMode pacer_mode = PACER_CAPPED;
+Uint64 pacer_frequency;
+Uint64 pacer_frame_period;
+Uint64 pacer_next_frame;
+Uint64 pacer_last_frame;
+
+// how long SDL_Delay(1) really takes in counter ticks, learned as the pacer sleeps
+double pacer_sleep_mean;
+double pacer_sleep_variance;
+unsigned int pacer_sleep_count;
+// past this many samples new ones still move the estimate, so it follows changes in system load
+const unsigned int PACER_MAX_SLEEP_SAMPLES = 1000;
+
+unsigned long pacer_frames = 0;
+double pacer_frame_time_sum = 0.0;
+double pacer_frame_time_squared_sum = 0.0;
+double pacer_frame_time_min = 0.0;
+double pacer_frame_time_max = 0.0;
+Uint64 pacer_start_time;
+std::clock_t pacer_start_clock;
+
+void pacer_init(PacerMode mode, unsigned int max_fps) {
+    if (mode == PACER_VSYNC && SDL_GL_SetSwapInterval(1) != 0) {
+        printf("Unable to enable vsync, capping the frame rate instead! SDL Error: %s\n", SDL_GetError());
+        mode = PACER_CAPPED;
+    }
+    if (mode != PACER_VSYNC) {
+        SDL_GL_SetSwapInterval(0);
+    }
+    pacer_mode = mode;
+
+    pacer_frequency = SDL_GetPerformanceFrequency();
+    pacer_frame_period = pacer_frequency / std::max(1u, max_fps);
+
+    // start out assuming sleeps are coarse, the estimate comes down once real ones have been measured
+    pacer_sleep_mean = pacer_frequency * 0.005;
+    pacer_sleep_variance = 0.0;
+    pacer_sleep_count = 1;
+
+    pacer_frames = 0;
+    pacer_frame_time_sum = 0.0;
+    pacer_frame_time_squared_sum = 0.0;
+
+    pacer_start_time = SDL_GetPerformanceCounter();
+    pacer_start_clock = std::clock();
+    pacer_last_frame = pacer_start_time;
+    pacer_next_frame = pacer_start_time + pacer_frame_period;
+}
+
+void pacer_sleep_until(Uint64 target) {
+    while (true) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= target) {
+            return;
+        }
+
+        double sleep_estimate = pacer_sleep_mean + std::sqrt(pacer_sleep_variance);
+        if ((double)(target - now) <= sleep_estimate) {
+            break;
+        }
+
+        SDL_Delay(1);
+        double observed = (double)(SDL_GetPerformanceCounter() - now);
+
+        // running mean and variance
+        pacer_sleep_count = std::min(pacer_sleep_count + 1, PACER_MAX_SLEEP_SAMPLES);
+        double weight = 1.0 / pacer_sleep_count;
+        double difference = observed - pacer_sleep_mean;
+        pacer_sleep_mean += difference * weight;
+        pacer_sleep_variance = (1.0 - weight) * (pacer_sleep_variance + (weight * difference * difference));
+    }
+
+    while (SDL_GetPerformanceCounter() < target) { }
+}
+
+float pacer_wait() {
+    ProfileScope profile_scope("pacer_wait");
+    if (pacer_mode == PACER_CAPPED) {
+        pacer_sleep_until(pacer_next_frame);
+
+        // frames are scheduled from the last target instead of from now so the rate doesn't drift,
+        // unless a frame ran so long that catching up would mean rushing the next few
+        pacer_next_frame += pacer_frame_period;
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now > pacer_next_frame) {
+            pacer_next_frame = now + pacer_frame_period;
+        }
+    }
+    // with vsync on the swap already waited, and uncapped doesn't wait at all
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    double frame_time = ((now - pacer_last_frame) * 1000.0) / pacer_frequency;
+    pacer_last_frame = now;
+
+    if (pacer_frames == 0) {
+        pacer_frame_time_min = frame_time;
+        pacer_frame_time_max = frame_time;
+    }
+    pacer_frames++;
+    pacer_frame_time_sum += frame_time;
+    pacer_frame_time_squared_sum += frame_time * frame_time;
+    pacer_frame_time_min = std::min(pacer_frame_time_min, frame_time);
+    pacer_frame_time_max = std::max(pacer_frame_time_max, frame_time);
+
+    return frame_time;
+}
+
+void pacer_print_stats() {
+    const char* mode_names[] = { "capped", "vsync", "uncapped" };
+    double elapsed = (double)(SDL_GetPerformanceCounter() - pacer_start_time) / pacer_frequency;
+    double cpu_time = (double)(std::clock() - pacer_start_clock) / CLOCKS_PER_SEC;
+    double mean = pacer_frames == 0 ? 0.0 : pacer_frame_time_sum / pacer_frames;
+    double variance = pacer_frames == 0 ? 0.0 : std::max(0.0, (pacer_frame_time_squared_sum / pacer_frames) - (mean * mean));
+
+    printf("Frame pacing %s, %lu frames in %.2f s\n", mode_names[pacer_mode], pacer_frames, elapsed);
+    printf("  frame time  %.3f ms mean, %.3f ms std dev, %.3f min, %.3f max\n", mean, std::sqrt(variance), pacer_frame_time_min, pacer_frame_time_max);
+    printf("  cpu         %.1f%% of one core\n", elapsed > 0.0 ? (cpu_time * 100.0) / elapsed : 0.0);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// keeps the main loop at a steady frame rate without spinning a core
+// waits sleep for most of the frame and only spin for the last part, which the scheduler can't be trusted with
+
+enum PacerMode {
+    PACER_CAPPED,
+    PACER_VSYNC,
+    PACER_UNCAPPED
+};
+
+// needs the GL context, since vsync is set on the swap interval
+void pacer_init(PacerMode mode, unsigned int max_fps);
+// blocks until the next frame should start, returns the milliseconds since the last frame started
+float pacer_wait();
+void pacer_print_stats();
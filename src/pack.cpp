@@ -0,0 +1,237 @@
+#include "pack.hpp"
+
+#include "file.hpp"
+#include "globals.hpp"
+
+#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+const char* PACK_PATH = "./assets.pak";
+const uint32_t PACK_MAGIC = 0x4b50475a; // "ZGPK"
+const uint32_t PACK_VERSION = 2;
+const size_t PACK_ALIGNMENT = 16;
+
+// everything startup opens, the texture cache isn't here since the game writes it
+const char* PACK_SOURCES[] = { "./config.ini", "./hack_10pt.bmp", "./map", "./res", "./shader" };
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t names_offset;
+    uint32_t names_size;
+    uint32_t padding[3];
+};
+
+struct PackEntry {
+    uint64_t name_hash;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint64_t offset;
+    uint32_t size;
+    // smaller than size when the file is deflated
+    uint32_t stored_size;
+    // of the loose file when it was packed, a loose file that doesn't match is read instead
+    int64_t modified_time;
+};
+
+MappedFile pack_file;
+const PackEntry* pack_entries = NULL;
+uint32_t pack_entry_count = 0;
+const char* pack_names = NULL;
+
+std::string pack_name(const std::string& path) {
+    std::string name = path.substr(0, 2) == "./" ? path.substr(2) : path;
+    std::replace(name.begin(), name.end(), '\\', '/');
+    return name;
+}
+
+bool pack_open(const std::string& path) {
+    pack_close();
+    if (!file_map(path, &pack_file)) {
+        return false;
+    }
+
+    // every offset is checked here once so that reads can trust the index
+    PackHeader header;
+    bool is_valid = pack_file.size >= sizeof(PackHeader);
+    if (is_valid) {
+        memcpy(&header, pack_file.data, sizeof(PackHeader));
+        size_t index_end = sizeof(PackHeader) + ((size_t)header.entry_count * sizeof(PackEntry));
+        is_valid = header.magic == PACK_MAGIC && header.version == PACK_VERSION && index_end <= header.names_offset &&
+                   (size_t)header.names_offset + header.names_size <= pack_file.size;
+    }
+    if (is_valid) {
+        pack_entries = (const PackEntry*)(pack_file.data + sizeof(PackHeader));
+        pack_entry_count = header.entry_count;
+        pack_names = (const char*)(pack_file.data + header.names_offset);
+        for (uint32_t i = 0; i < pack_entry_count && is_valid; i++) {
+            const PackEntry& entry = pack_entries[i];
+            is_valid = (size_t)entry.name_offset + entry.name_length <= header.names_size && entry.offset + entry.stored_size <= pack_file.size &&
+                       entry.stored_size <= entry.size && (i == 0 || pack_entries[i - 1].name_hash <= entry.name_hash);
+        }
+    }
+    if (!is_valid) {
+        printf("Asset pack %s is corrupt or out of date, using the loose files\n", path.c_str());
+        pack_close();
+        return false;
+    }
+
+    if (trace_loading) {
+        printf("Opened asset pack %s, %u files\n", path.c_str(), pack_entry_count);
+    }
+    return true;
+}
+
+void pack_close() {
+    if (pack_file.data != NULL) {
+        file_unmap(&pack_file);
+    }
+    pack_entries = NULL;
+    pack_entry_count = 0;
+    pack_names = NULL;
+}
+
+const PackEntry* pack_find(const std::string& name) {
+    uint64_t hash = file_hash(name.data(), name.size());
+    const PackEntry* end = pack_entries + pack_entry_count;
+    const PackEntry* entry = std::lower_bound(pack_entries, end, hash, [](const PackEntry& entry, uint64_t hash) {
+        return entry.name_hash < hash;
+    });
+    for (; entry != end && entry->name_hash == hash; entry++) {
+        if (entry->name_length == name.size() && memcmp(pack_names + entry->name_offset, name.data(), name.size()) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+bool pack_read(const std::string& path, std::vector<unsigned char>* data) {
+    const PackEntry* entry = pack_entries == NULL ? NULL : pack_find(pack_name(path));
+    if (entry == NULL) {
+        return file_read(path, data);
+    }
+
+    // shipped builds have no loose files, when there is one that differs it's an edit the pack doesn't have yet
+    uint64_t loose_size;
+    int64_t loose_modified_time;
+    if (file_stat(path, &loose_size, &loose_modified_time) && (loose_size != entry->size || loose_modified_time != entry->modified_time)) {
+        printf("%s has changed since %s was built, reading the loose file\n", path.c_str(), PACK_PATH);
+        return file_read(path, data);
+    }
+
+    data->resize(entry->size);
+    if (entry->size == 0) {
+        return true;
+    }
+    const unsigned char* stored = pack_file.data + entry->offset;
+    if (entry->stored_size == entry->size) {
+        memcpy(&(*data)[0], stored, entry->size);
+        return true;
+    }
+
+    uLongf size = entry->size;
+    if (uncompress(&(*data)[0], &size, stored, entry->stored_size) != Z_OK || size != entry->size) {
+        printf("Unable to inflate %s from the asset pack\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool pack_build(const std::string& path) {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::string> paths;
+    for (const char* source : PACK_SOURCES) {
+        if (!file_list(source, &paths)) {
+            printf("Unable to read %s for the asset pack\n", source);
+            return false;
+        }
+    }
+
+    std::vector<PackEntry> entries(paths.size());
+    std::string names;
+    std::vector<std::vector<unsigned char>> blobs(paths.size());
+    size_t total_size = 0;
+    unsigned int num_compressed = 0;
+    for (unsigned int i = 0; i < paths.size(); i++) {
+        std::string name = pack_name(paths[i]);
+        std::vector<unsigned char> contents;
+        uint64_t size;
+        if (!file_stat(paths[i], &size, &entries[i].modified_time) || !file_read(paths[i], &contents)) {
+            printf("Unable to read %s for the asset pack\n", paths[i].c_str());
+            return false;
+        }
+
+        entries[i].name_hash = file_hash(name.data(), name.size());
+        entries[i].name_offset = names.size();
+        entries[i].name_length = name.size();
+        entries[i].size = contents.size();
+        names += name;
+        total_size += contents.size();
+
+        // images are already compressed, only keep the deflated copy when it saves something worthwhile
+        uLongf compressed_size = compressBound(contents.size());
+        blobs[i].resize(compressed_size);
+        if (!contents.empty() && compress2(&blobs[i][0], &compressed_size, &contents[0], contents.size(), Z_BEST_COMPRESSION) == Z_OK &&
+            compressed_size < contents.size() - (contents.size() / 8)) {
+            blobs[i].resize(compressed_size);
+            num_compressed++;
+        } else {
+            blobs[i].swap(contents);
+        }
+        entries[i].stored_size = blobs[i].size();
+    }
+
+    // sorting the index by hash lets lookups binary search it, the blobs keep their original order
+    std::vector<unsigned int> order(paths.size());
+    for (unsigned int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&entries](unsigned int a, unsigned int b) {
+        return entries[a].name_hash < entries[b].name_hash;
+    });
+
+    PackHeader header = {
+        .magic = PACK_MAGIC,
+        .version = PACK_VERSION,
+        .entry_count = (uint32_t)entries.size(),
+        .names_offset = (uint32_t)(sizeof(PackHeader) + (entries.size() * sizeof(PackEntry))),
+        .names_size = (uint32_t)names.size(),
+        .padding = { 0, 0, 0 }
+    };
+    size_t offset = header.names_offset + names.size();
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        offset = (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+        entries[i].offset = offset;
+        offset += blobs[i].size();
+    }
+
+    std::vector<unsigned char> bytes(offset, 0);
+    memcpy(&bytes[0], &header, sizeof(PackHeader));
+    for (unsigned int i = 0; i < order.size(); i++) {
+        memcpy(&bytes[sizeof(PackHeader) + (i * sizeof(PackEntry))], &entries[order[i]], sizeof(PackEntry));
+    }
+    if (!names.empty()) {
+        memcpy(&bytes[header.names_offset], names.data(), names.size());
+    }
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        if (!blobs[i].empty()) {
+            memcpy(&bytes[entries[i].offset], &blobs[i][0], blobs[i].size());
+        }
+    }
+
+    if (!file_write_atomic(path, bytes)) {
+        printf("Unable to write asset pack %s\n", path.c_str());
+        return false;
+    }
+
+    float build_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    printf("Packed %u files into %s in %.2f ms, %.2f MB from %.2f MB, %u deflated\n", (unsigned int)entries.size(), path.c_str(), build_time,
+           bytes.size() / (1024.0f * 1024.0f), total_size / (1024.0f * 1024.0f), num_compressed);
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// every file startup reads, packed into one file that's mapped once instead of opening each on its own
+// a header, an index sorted by name hash, the names, then the files aligned to 16 bytes,
+// files that deflate well are stored compressed and everything else as it is
+// files that aren't in the pack, or every file when there's no pack, are read from the loose files instead
+// so are packed files whose loose file has changed since the pack was built, so edits aren't hidden by a stale pack
+
+extern const char* PACK_PATH;
+
+// a missing pack isn't an error, that's how development runs off the loose files
+bool pack_open(const std::string& path);
+void pack_close();
+// the path is the loose file path, with or without the leading ./
+bool pack_read(const std::string& path, std::vector<unsigned char>* data);
+// packs the loose files the game loads at startup
+bool pack_build(const std::string& path);
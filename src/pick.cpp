@@ -0,0 +1,349 @@
+#include "pick.hpp"
+
+#include "level.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+// leaves split once they hold more than this many items, unless they're already this small
+const unsigned int PICK_NODE_CAPACITY = 16;
+const float PICK_MIN_NODE_SIZE = 1.0f / 64.0f;
+const float PICK_INITIAL_ROOT_SIZE = 64.0f;
+
+struct PickEntry {
+    PickItem item;
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+struct PickNode {
+    glm::vec2 min;
+    glm::vec2 max;
+    // -1 for leaves
+    int children[4];
+    // items that fit inside this node but not inside any one of its children
+    std::vector<PickEntry> entries;
+};
+
+std::vector<PickNode> pick_nodes;
+int pick_root = -1;
+// which node each item is stored in, so that moving an item doesn't need a search
+std::unordered_map<uint64_t, unsigned int> pick_item_nodes;
+unsigned int pick_num_enemies = 0;
+unsigned int pick_num_lights = 0;
+
+uint64_t pick_key(PickItem item) {
+    return ((uint64_t)item.type << 60) | ((uint64_t)item.index << 30) | item.sub_index;
+}
+
+bool pick_contains(const PickNode& node, glm::vec2 min, glm::vec2 max) {
+    return min.x >= node.min.x && min.y >= node.min.y && max.x <= node.max.x && max.y <= node.max.y;
+}
+
+bool pick_overlaps(glm::vec2 a_min, glm::vec2 a_max, glm::vec2 b_min, glm::vec2 b_max) {
+    return a_min.x <= b_max.x && a_max.x >= b_min.x && a_min.y <= b_max.y && a_max.y >= b_min.y;
+}
+
+unsigned int pick_add_node(glm::vec2 min, glm::vec2 max) {
+    PickNode node;
+    node.min = min;
+    node.max = max;
+    for (unsigned int i = 0; i < 4; i++) {
+        node.children[i] = -1;
+    }
+    pick_nodes.push_back(node);
+
+    return pick_nodes.size() - 1;
+}
+
+glm::vec2 pick_quadrant_min(glm::vec2 min, glm::vec2 max, unsigned int quadrant) {
+    glm::vec2 center = (min + max) * 0.5f;
+    return glm::vec2((quadrant & 1) ? center.x : min.x, (quadrant & 2) ? center.y : min.y);
+}
+
+void pick_insert_entry(unsigned int node_index, const PickEntry& entry);
+
+void pick_split(unsigned int node_index) {
+    for (unsigned int i = 0; i < 4; i++) {
+        glm::vec2 child_min = pick_quadrant_min(pick_nodes[node_index].min, pick_nodes[node_index].max, i);
+        glm::vec2 child_size = (pick_nodes[node_index].max - pick_nodes[node_index].min) * 0.5f;
+        unsigned int child = pick_add_node(child_min, child_min + child_size);
+        pick_nodes[node_index].children[i] = child;
+    }
+
+    std::vector<PickEntry> entries;
+    entries.swap(pick_nodes[node_index].entries);
+    for (const PickEntry& entry : entries) {
+        pick_insert_entry(node_index, entry);
+    }
+}
+
+void pick_insert_entry(unsigned int node_index, const PickEntry& entry) {
+    // nodes are referenced by index since splitting can reallocate pick_nodes
+    while (true) {
+        if (pick_nodes[node_index].children[0] == -1) {
+            pick_nodes[node_index].entries.push_back(entry);
+            pick_item_nodes[pick_key(entry.item)] = node_index;
+
+            PickNode& node = pick_nodes[node_index];
+            if (node.entries.size() > PICK_NODE_CAPACITY && node.max.x - node.min.x > PICK_MIN_NODE_SIZE) {
+                pick_split(node_index);
+            }
+            return;
+        }
+
+        int fitting_child = -1;
+        for (unsigned int i = 0; i < 4; i++) {
+            if (pick_contains(pick_nodes[pick_nodes[node_index].children[i]], entry.min, entry.max)) {
+                fitting_child = pick_nodes[node_index].children[i];
+                break;
+            }
+        }
+        if (fitting_child == -1) {
+            pick_nodes[node_index].entries.push_back(entry);
+            pick_item_nodes[pick_key(entry.item)] = node_index;
+            return;
+        }
+        node_index = fitting_child;
+    }
+}
+
+void pick_grow_root(glm::vec2 min, glm::vec2 max) {
+    if (pick_root == -1) {
+        glm::vec2 center = glm::floor((min + max) * 0.5f);
+        pick_root = pick_add_node(center - (PICK_INITIAL_ROOT_SIZE * 0.5f), center + (PICK_INITIAL_ROOT_SIZE * 0.5f));
+    }
+
+    // double the root towards the item until it fits, the old root becomes one quadrant of the new one
+    while (!pick_contains(pick_nodes[pick_root], min, max)) {
+        glm::vec2 old_min = pick_nodes[pick_root].min;
+        glm::vec2 size = pick_nodes[pick_root].max - old_min;
+        bool grow_left = min.x < old_min.x;
+        bool grow_up = min.y < old_min.y;
+        glm::vec2 new_min = glm::vec2(grow_left ? old_min.x - size.x : old_min.x, grow_up ? old_min.y - size.y : old_min.y);
+
+        unsigned int old_root = pick_root;
+        unsigned int old_quadrant = (grow_left ? 1 : 0) | (grow_up ? 2 : 0);
+        pick_root = pick_add_node(new_min, new_min + (size * 2.0f));
+        for (unsigned int i = 0; i < 4; i++) {
+            if (i == old_quadrant) {
+                pick_nodes[pick_root].children[i] = old_root;
+            } else {
+                glm::vec2 child_min = pick_quadrant_min(new_min, new_min + (size * 2.0f), i);
+                unsigned int child = pick_add_node(child_min, child_min + size);
+                pick_nodes[pick_root].children[i] = child;
+            }
+        }
+    }
+}
+
+void pick_clear() {
+    pick_nodes.clear();
+    pick_root = -1;
+    pick_item_nodes.clear();
+    pick_num_enemies = 0;
+    pick_num_lights = 0;
+}
+
+void pick_update(PickItem item, glm::vec2 min, glm::vec2 max) {
+    pick_remove(item);
+    pick_grow_root(min, max);
+    pick_insert_entry(pick_root, {
+        .item = item,
+        .min = min,
+        .max = max
+    });
+}
+
+void pick_remove(PickItem item) {
+    uint64_t key = pick_key(item);
+    std::unordered_map<uint64_t, unsigned int>::iterator item_node = pick_item_nodes.find(key);
+    if (item_node == pick_item_nodes.end()) {
+        return;
+    }
+
+    std::vector<PickEntry>& entries = pick_nodes[item_node->second].entries;
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        if (pick_key(entries[i].item) == key) {
+            entries[i] = entries.back();
+            entries.pop_back();
+            break;
+        }
+    }
+    pick_item_nodes.erase(item_node);
+}
+
+void pick_query(glm::vec2 min, glm::vec2 max, std::vector<PickItem>* results) {
+    if (pick_root == -1) {
+        return;
+    }
+
+    std::vector<unsigned int> stack;
+    stack.push_back(pick_root);
+    while (!stack.empty()) {
+        const PickNode& node = pick_nodes[stack.back()];
+        stack.pop_back();
+        if (!pick_overlaps(node.min, node.max, min, max)) {
+            continue;
+        }
+
+        for (const PickEntry& entry : node.entries) {
+            if (pick_overlaps(entry.min, entry.max, min, max)) {
+                results->push_back(entry.item);
+            }
+        }
+        if (node.children[0] != -1) {
+            for (unsigned int i = 0; i < 4; i++) {
+                stack.push_back(node.children[i]);
+            }
+        }
+    }
+}
+
+void pick_update_wall(unsigned int index, unsigned int wall) {
+    const Sector& sector = sectors[index];
+    glm::vec2 a = sector.vertices[wall];
+    glm::vec2 b = sector.vertices[(wall + 1) % sector.vertices.size()];
+    pick_update({ .type = PICK_WALL, .index = index, .sub_index = wall }, glm::min(a, b), glm::max(a, b));
+}
+
+void pick_build_level() {
+    pick_clear();
+    for (unsigned int i = 0; i < sectors.size(); i++) {
+        pick_update_sector(i);
+    }
+    pick_update_objects();
+}
+
+void pick_update_sector(unsigned int index) {
+    const Sector& sector = sectors[index];
+    for (unsigned int i = 0; i < sector.vertices.size(); i++) {
+        pick_update({ .type = PICK_VERTEX, .index = index, .sub_index = i }, sector.vertices[i], sector.vertices[i]);
+        pick_update_wall(index, i);
+    }
+}
+
+void pick_update_sector_vertex(unsigned int index, unsigned int vertex) {
+    const Sector& sector = sectors[index];
+    pick_update({ .type = PICK_VERTEX, .index = index, .sub_index = vertex }, sector.vertices[vertex], sector.vertices[vertex]);
+    pick_update_wall(index, vertex);
+    pick_update_wall(index, (vertex + sector.vertices.size() - 1) % sector.vertices.size());
+}
+
+void pick_update_object(PickType type, unsigned int index) {
+    glm::vec3 position = player_spawn_point;
+    if (type == PICK_ENEMY) {
+        position = enemy_spawns[index].position;
+    } else if (type == PICK_LIGHT) {
+        position = lights[index].position;
+    }
+    pick_update({ .type = type, .index = index, .sub_index = 0 }, glm::vec2(position.x, position.z), glm::vec2(position.x, position.z));
+}
+
+void pick_update_objects() {
+    pick_update_object(PICK_PLAYER, 0);
+
+    // adding or deleting objects shifts indices around, so all of them are updated together
+    for (unsigned int i = enemy_spawns.size(); i < pick_num_enemies; i++) {
+        pick_remove({ .type = PICK_ENEMY, .index = i, .sub_index = 0 });
+    }
+    for (unsigned int i = 0; i < enemy_spawns.size(); i++) {
+        pick_update_object(PICK_ENEMY, i);
+    }
+    pick_num_enemies = enemy_spawns.size();
+
+    for (unsigned int i = lights.size(); i < pick_num_lights; i++) {
+        pick_remove({ .type = PICK_LIGHT, .index = i, .sub_index = 0 });
+    }
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        pick_update_object(PICK_LIGHT, i);
+    }
+    pick_num_lights = lights.size();
+}
+
+float pick_elapsed_us(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void pick_benchmark(unsigned int num_vertices) {
+    // a grid of square rooms, four vertices each
+    unsigned int num_sectors = std::max(1u, num_vertices / 4);
+    unsigned int grid_size = (unsigned int)std::ceil(std::sqrt((float)num_sectors));
+    sectors.clear();
+    sectors.resize(num_sectors);
+    for (unsigned int i = 0; i < num_sectors; i++) {
+        glm::vec2 corner = glm::vec2((i % grid_size) * 4.0f, (i / grid_size) * 4.0f);
+        sectors[i].add_vertex(corner, 0, true);
+        sectors[i].add_vertex(corner + glm::vec2(3.0f, 0.0f), 0, true);
+        sectors[i].add_vertex(corner + glm::vec2(3.0f, 3.0f), 0, true);
+        sectors[i].add_vertex(corner + glm::vec2(0.0f, 3.0f), 0, true);
+    }
+    float map_size = grid_size * 4.0f;
+    srand(1);
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    pick_build_level();
+    float build_time = pick_elapsed_us(start_time);
+
+    // clicks use the same box size as a vertex handle at the default editor scale
+    const unsigned int NUM_CLICKS = 100000;
+    std::vector<PickItem> results;
+    unsigned int click_hits = 0;
+    start_time = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NUM_CLICKS; i++) {
+        glm::vec2 point = glm::vec2(rand() % (int)map_size, rand() % (int)map_size);
+        results.clear();
+        pick_query(point - 0.25f, point + 0.25f, &results);
+        click_hits += results.size();
+    }
+    float click_time = pick_elapsed_us(start_time) / NUM_CLICKS;
+
+    const unsigned int NUM_BOXES = 10000;
+    unsigned int box_hits = 0;
+    start_time = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NUM_BOXES; i++) {
+        glm::vec2 point = glm::vec2(rand() % (int)map_size, rand() % (int)map_size);
+        results.clear();
+        pick_query(point, point + 16.0f, &results);
+        box_hits += results.size();
+    }
+    float box_time = pick_elapsed_us(start_time) / NUM_BOXES;
+
+    const unsigned int NUM_MOVES = 100000;
+    start_time = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NUM_MOVES; i++) {
+        unsigned int sector = rand() % num_sectors;
+        unsigned int vertex = rand() % 4;
+        sectors[sector].vertices[vertex] += glm::vec2(((rand() % 3) - 1) * 0.125f, ((rand() % 3) - 1) * 0.125f);
+        pick_update_sector_vertex(sector, vertex);
+    }
+    float move_time = pick_elapsed_us(start_time) / NUM_MOVES;
+
+    // the old way, testing every vertex of every sector
+    const unsigned int NUM_SCANS = 100;
+    unsigned int scan_hits = 0;
+    start_time = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NUM_SCANS; i++) {
+        glm::vec2 point = glm::vec2(rand() % (int)map_size, rand() % (int)map_size);
+        for (const Sector& sector : sectors) {
+            for (const glm::vec2& vertex : sector.vertices) {
+                if (std::fabs(vertex.x - point.x) <= 0.25f && std::fabs(vertex.y - point.y) <= 0.25f) {
+                    scan_hits++;
+                }
+            }
+        }
+    }
+    float scan_time = pick_elapsed_us(start_time) / NUM_SCANS;
+
+    printf("Pick benchmark, %u vertices in %u sectors, %u quadtree nodes\n", num_sectors * 4, num_sectors, (unsigned int)pick_nodes.size());
+    printf("  build      %10.2f ms\n", build_time / 1000.0f);
+    printf("  click      %10.3f us  (%u hits)\n", click_time, click_hits);
+    printf("  box 16x16  %10.3f us  (%u hits)\n", box_time, box_hits);
+    printf("  move       %10.3f us\n", move_time);
+    printf("  linear     %10.3f us per click, without the index  (%u hits)\n", scan_time, scan_hits);
+}
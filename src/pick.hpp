@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// spatial index over everything the editor can click on, in map coordinates
+
+enum PickType {
+    PICK_VERTEX,
+    PICK_WALL,
+    PICK_PLAYER,
+    PICK_ENEMY,
+    PICK_LIGHT
+};
+
+struct PickItem {
+    PickType type;
+    // sector, enemy spawn or light index
+    unsigned int index;
+    // vertex or wall index inside the sector, walls go from vertex sub_index to the next one
+    unsigned int sub_index;
+};
+
+void pick_clear();
+// inserts the item, or moves it if it's already in the index
+void pick_update(PickItem item, glm::vec2 min, glm::vec2 max);
+void pick_remove(PickItem item);
+// appends every item whose bounds overlap the box
+void pick_query(glm::vec2 min, glm::vec2 max, std::vector<PickItem>* results);
+
+// helpers that read positions out of the level
+void pick_build_level();
+void pick_update_sector(unsigned int index);
+void pick_update_sector_vertex(unsigned int index, unsigned int vertex);
+// only for moving objects, use pick_update_objects when objects are added or deleted
+void pick_update_object(PickType type, unsigned int index);
+void pick_update_objects();
+
+void pick_benchmark(unsigned int num_vertices);
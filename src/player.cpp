@@ -6,6 +6,8 @@
 #include "shader.hpp"
 #include "globals.hpp"
 #include "font.hpp"
+#include "profile.hpp"
+#include "arena.hpp"
 
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -33,6 +35,10 @@ void Player::init() {
     direction = -glm::vec3(basis[2]);
     flashlight_direction = -glm::vec3(basis[2]);
     flashlight_on = false;
+    previous_position = position;
+    previous_basis = basis;
+    previous_direction = direction;
+    previous_flashlight_direction = flashlight_direction;
 
     recoil = 0.0f;
     recoil_cooldown = 0.1f;
@@ -61,13 +67,16 @@ void Player::init() {
         .frame_time = 1.0f
     });
 
-    glUseProgram(screen_shader);
-    glUniform1ui(glGetUniformLocation(screen_shader, "player_health"), health);
-
     screen_animation = SCREEN_ANIMATION_NONE;
 }
 
 void Player::update(float delta) {
+    ProfileScope profile_scope("Player::update");
+    previous_position = position;
+    previous_basis = basis;
+    previous_direction = direction;
+    previous_flashlight_direction = flashlight_direction;
+
     // rotation input
     glm::vec3 rotation_input = glm::vec3(0.0f, -input.mouse_raw_yrel, -input.mouse_raw_xrel);
     if (input.is_action_pressed[INPUT_YAW_ROLL]) {
@@ -180,8 +189,6 @@ void Player::take_damage(unsigned int amount) {
         return;
     }
     health -= std::min(amount, health);
-    glUseProgram(screen_shader);
-    glUniform1ui(glGetUniformLocation(screen_shader, "player_health"), health);
     if (health <= 0) {
         is_dead = true;
         screen_animation = SCREEN_ANIMATION_FADE;
@@ -191,22 +198,31 @@ void Player::take_damage(unsigned int amount) {
     screen_anim_timer = 0.0f;
 }
 
-void Player::render() {
+PlayerHud Player::capture_hud() const {
+    return {
+        .pistol_frame = animation.frame,
+        .pistol_normal = glm::normalize(glm::vec3(basis[2])),
+        .recoil = recoil,
+        .health = health,
+        .max_health = max_health,
+        .clip_ammo = clip_ammo,
+        .reserve_ammo = reserve_ammo
+    };
+}
+
+void player_render_hud(const PlayerHud& hud) {
     // prepare billboard shader for gun
-    glUniform2iv(glGetUniformLocation(billboard_shader, "extents"), 1, glm::value_ptr(resource_extents[resource_player_pistol]));
     glm::mat4 unit_mat4 = glm::mat4(1.0f);
     glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "projection"), 1, GL_FALSE, glm::value_ptr(unit_mat4));
     glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "view"), 1, GL_FALSE, glm::value_ptr(unit_mat4));
     glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "model"), 1, GL_FALSE, glm::value_ptr(unit_mat4));
-    glm::vec3 normal = glm::normalize(glm::vec3(basis[2]));
-    glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(normal));
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), animation.frame);
+    glUniform3fv(glGetUniformLocation(billboard_shader, "normal"), 1, glm::value_ptr(hud.pistol_normal));
     glUniform1ui(glGetUniformLocation(billboard_shader, "flip_h"), false);
 
     // render gun
     glDisable(GL_DEPTH_TEST);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, resource_player_pistol);
+    resource_bind_sprite(resource_player_pistol, hud.pistol_frame);
+    glBindVertexArray(quad_vao);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
 
@@ -218,7 +234,7 @@ void Player::render() {
     glBindVertexArray(quad_vao);
 
     // top part
-    glm::ivec2 crosshair_position = glm::ivec2(0, 8 + (int)(16.0f * recoil));
+    glm::ivec2 crosshair_position = glm::ivec2(0, 8 + (int)(16.0f * hud.recoil));
     glUniform2iv(glGetUniformLocation(ui_shader, "position"), 1, glm::value_ptr(crosshair_position));
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
@@ -241,8 +257,7 @@ void Player::render() {
     glBindVertexArray(0);
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    std::string health_string = "HEALTH: " + std::to_string(health) + "/" + std::to_string(max_health);
-    font_hack_10pt.render_text(health_string, 0.0f, 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-    std::string ammo_string = "AMMO: " + std::to_string(clip_ammo) + "/" + std::to_string(reserve_ammo);
-    font_hack_10pt.render_text(ammo_string, 0.0f, 10.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+    // formatted here rather than in the capture, the snapshot outlives the simulation thread's arena
+    font_hack_10pt.render_text(arena_printf("HEALTH: %u/%u", hud.health, hud.max_health), 0.0f, 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+    font_hack_10pt.render_text(arena_printf("AMMO: %u/%u", hud.clip_ammo, hud.reserve_ammo), 0.0f, 10.0f, glm::vec3(1.0f, 1.0f, 1.0f));
 }
@@ -4,6 +4,7 @@
 #include "raycast.hpp"
 
 #include <glm/glm.hpp>
+#include <string>
 
 enum ScreenAnimation {
     SCREEN_ANIMATION_NONE,
@@ -11,6 +12,17 @@ enum ScreenAnimation {
     SCREEN_ANIMATION_FADE
 };
 
+// what the hud shows of the player, captured with the rest of the frame
+struct PlayerHud {
+    unsigned int pistol_frame;
+    glm::vec3 pistol_normal;
+    float recoil;
+    unsigned int health;
+    unsigned int max_health;
+    unsigned int clip_ammo;
+    unsigned int reserve_ammo;
+};
+
 struct Player {
     glm::vec3 position;
     glm::vec3 velocity;
@@ -20,6 +32,12 @@ struct Player {
     bool flashlight_on;
     glm::vec3 flashlight_direction;
 
+    // the state at the start of the last tick, rendering interpolates from it
+    glm::vec3 previous_position;
+    glm::mat4 previous_basis;
+    glm::vec3 previous_direction;
+    glm::vec3 previous_flashlight_direction;
+
     Animation animation;
     ScreenAnimation screen_animation;
 
@@ -40,5 +58,7 @@ struct Player {
     void init();
     void update(float delta);
     void take_damage(unsigned int amount);
-    void render();
+    PlayerHud capture_hud() const;
 };
+
+void player_render_hud(const PlayerHud& hud);
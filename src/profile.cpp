@@ -0,0 +1,396 @@
+#include "profile.hpp"
+
+#include "font.hpp"
+#include "arena.hpp"
+
+#include <glad/glad.h>
+#include <contrib/rapidjson/include/rapidjson/filewritestream.h>
+#include <contrib/rapidjson/include/rapidjson/writer.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+struct ProfileSample {
+    const char* name;
+    // nanoseconds since the profiler started
+    uint64_t start;
+    uint64_t end;
+    uint32_t thread;
+};
+
+// a slot's sequence is its write index plus one once the sample is complete, and 0 while it's being written,
+// so readers can tell finished samples apart from ones that are still being written or were overwritten
+struct ProfileSlot {
+    std::atomic<uint64_t> sequence;
+    ProfileSample sample;
+};
+
+const unsigned int PROFILE_RING_SIZE = 1 << 16;
+const unsigned int PROFILE_MAX_THREADS = 16;
+// GPU samples go on their own row in the trace
+const uint32_t PROFILE_GPU_THREAD = PROFILE_MAX_THREADS;
+// timer query results are read this many frames after they were issued, so reading them never stalls
+const unsigned int PROFILE_GPU_FRAMES = 4;
+const unsigned int PROFILE_GPU_PASSES = 8;
+// how much each frame moves the breakdown's averages
+const float PROFILE_SMOOTHING = 0.05f;
+
+bool profile_enabled = false;
+bool profile_track_scopes = false;
+
+ProfileSlot profile_ring[PROFILE_RING_SIZE];
+std::atomic<uint64_t> profile_write_index(0);
+uint64_t profile_read_index = 0;
+std::chrono::steady_clock::time_point profile_start_time = std::chrono::steady_clock::now();
+
+std::atomic<uint32_t> profile_thread_count(0);
+const char* profile_thread_names[PROFILE_MAX_THREADS + 1];
+thread_local int profile_thread = -1;
+thread_local const char* profile_scope = nullptr;
+
+struct ProfileGpuPass {
+    const char* name;
+    unsigned int query;
+    uint64_t start;
+};
+
+bool profile_gpu_queries = false;
+ProfileGpuPass profile_gpu_passes[PROFILE_GPU_FRAMES][PROFILE_GPU_PASSES];
+unsigned int profile_gpu_pass_count[PROFILE_GPU_FRAMES];
+unsigned int profile_gpu_frame = 0;
+bool profile_gpu_pass_open = false;
+
+// one node of the call tree the breakdown shows
+struct ProfileEntry {
+    const char* name;
+    uint32_t thread;
+    int parent;
+    float frame_ms;
+    float average_ms;
+};
+
+std::vector<ProfileEntry> profile_entries;
+std::vector<ProfileSample> profile_frame_samples;
+
+const char* profile_current_scope() {
+    return profile_scope;
+}
+
+uint64_t profile_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profile_start_time).count();
+}
+
+uint32_t profile_thread_id() {
+    if (profile_thread == -1) {
+        profile_thread = std::min(profile_thread_count.fetch_add(1), PROFILE_MAX_THREADS - 1);
+    }
+    return profile_thread;
+}
+
+void profile_push(const ProfileSample& sample) {
+    uint64_t index = profile_write_index.fetch_add(1, std::memory_order_relaxed);
+    ProfileSlot& slot = profile_ring[index % PROFILE_RING_SIZE];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+// returns false when the sample at index isn't finished yet, or was already overwritten
+bool profile_read(uint64_t index, ProfileSample* sample) {
+    ProfileSlot& slot = profile_ring[index % PROFILE_RING_SIZE];
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+        return false;
+    }
+    *sample = slot.sample;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+}
+
+void ProfileScope::begin(const char* scope_name) {
+    name = scope_name;
+    parent = profile_scope;
+    profile_scope = name;
+    // the profiler can be turned on halfway through a scope, only scopes that started timed get pushed
+    timed = profile_enabled;
+    if (timed) {
+        start = profile_now();
+    }
+}
+
+void ProfileScope::end() {
+    profile_scope = parent;
+    if (!timed) {
+        return;
+    }
+
+    uint64_t end_time = profile_now();
+    profile_push({
+        .name = name,
+        .start = start,
+        .end = end_time,
+        .thread = profile_thread_id()
+    });
+}
+
+void profile_init(bool gpu_queries) {
+    profile_thread_name("main");
+
+    profile_gpu_queries = gpu_queries;
+    if (profile_gpu_queries) {
+        profile_thread_names[PROFILE_GPU_THREAD] = "gpu";
+        for (unsigned int frame = 0; frame < PROFILE_GPU_FRAMES; frame++) {
+            for (unsigned int pass = 0; pass < PROFILE_GPU_PASSES; pass++) {
+                glGenQueries(1, &profile_gpu_passes[frame][pass].query);
+            }
+            profile_gpu_pass_count[frame] = 0;
+        }
+    }
+}
+
+void profile_quit() {
+    if (profile_gpu_queries) {
+        for (unsigned int frame = 0; frame < PROFILE_GPU_FRAMES; frame++) {
+            for (unsigned int pass = 0; pass < PROFILE_GPU_PASSES; pass++) {
+                glDeleteQueries(1, &profile_gpu_passes[frame][pass].query);
+            }
+        }
+    }
+    profile_gpu_queries = false;
+}
+
+void profile_thread_name(const char* name) {
+    profile_thread_names[profile_thread_id()] = name;
+}
+
+void profile_gpu_begin(const char* name) {
+    if (!profile_gpu_queries || !profile_enabled) {
+        return;
+    }
+    profile_gpu_end();
+
+    unsigned int& pass_count = profile_gpu_pass_count[profile_gpu_frame];
+    if (pass_count == PROFILE_GPU_PASSES) {
+        return;
+    }
+    ProfileGpuPass& pass = profile_gpu_passes[profile_gpu_frame][pass_count];
+    pass.name = name;
+    pass.start = profile_now();
+    glBeginQuery(GL_TIME_ELAPSED, pass.query);
+    pass_count++;
+    profile_gpu_pass_open = true;
+}
+
+void profile_gpu_end() {
+    if (!profile_gpu_pass_open) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    profile_gpu_pass_open = false;
+}
+
+void profile_collect_gpu_passes() {
+    profile_gpu_end();
+    profile_gpu_frame = (profile_gpu_frame + 1) % PROFILE_GPU_FRAMES;
+
+    // the oldest frame's queries are reused now, the ones that still aren't done are dropped instead of waited on
+    for (unsigned int i = 0; i < profile_gpu_pass_count[profile_gpu_frame]; i++) {
+        const ProfileGpuPass& pass = profile_gpu_passes[profile_gpu_frame][i];
+        GLuint available = 0;
+        glGetQueryObjectuiv(pass.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(pass.query, GL_QUERY_RESULT, &elapsed_ns);
+        // GPU clocks don't line up with the CPU's, so passes are placed where they were issued
+        profile_push({
+            .name = pass.name,
+            .start = pass.start,
+            .end = pass.start + elapsed_ns,
+            .thread = PROFILE_GPU_THREAD
+        });
+    }
+    profile_gpu_pass_count[profile_gpu_frame] = 0;
+}
+
+int profile_find_entry(const char* name, uint32_t thread, int parent) {
+    for (unsigned int i = 0; i < profile_entries.size(); i++) {
+        const ProfileEntry& entry = profile_entries[i];
+        if (entry.thread == thread && entry.parent == parent && strcmp(entry.name, name) == 0) {
+            return i;
+        }
+    }
+
+    profile_entries.push_back({
+        .name = name,
+        .thread = thread,
+        .parent = parent,
+        .frame_ms = 0.0f,
+        .average_ms = 0.0f
+    });
+    return profile_entries.size() - 1;
+}
+
+void profile_frame_end() {
+    if (profile_gpu_queries) {
+        profile_collect_gpu_passes();
+    }
+
+    uint64_t write_index = profile_write_index.load(std::memory_order_acquire);
+    if (write_index - profile_read_index > PROFILE_RING_SIZE) {
+        profile_read_index = write_index - PROFILE_RING_SIZE;
+    }
+    profile_frame_samples.clear();
+    for (; profile_read_index < write_index; profile_read_index++) {
+        // a sample that isn't finished yet holds back the ones after it until the next frame
+        if (profile_ring[profile_read_index % PROFILE_RING_SIZE].sequence.load(std::memory_order_acquire) < profile_read_index + 1) {
+            break;
+        }
+        ProfileSample sample;
+        if (profile_read(profile_read_index, &sample)) {
+            profile_frame_samples.push_back(sample);
+        }
+    }
+    if (profile_frame_samples.empty() && profile_entries.empty()) {
+        return;
+    }
+
+    // samples are written when their scope ends, sorting by start puts parents before their children
+    std::sort(profile_frame_samples.begin(), profile_frame_samples.end(), [](const ProfileSample& a, const ProfileSample& b) {
+        return a.thread < b.thread || (a.thread == b.thread && a.start < b.start);
+    });
+
+    for (ProfileEntry& entry : profile_entries) {
+        entry.frame_ms = 0.0f;
+    }
+    std::vector<std::pair<int, uint64_t>> stack;
+    uint32_t stack_thread = 0;
+    for (const ProfileSample& sample : profile_frame_samples) {
+        if (sample.thread != stack_thread) {
+            stack.clear();
+            stack_thread = sample.thread;
+        }
+        while (!stack.empty() && stack.back().second <= sample.start) {
+            stack.pop_back();
+        }
+
+        int parent = stack.empty() ? -1 : stack.back().first;
+        int entry = profile_find_entry(sample.name, sample.thread, parent);
+        profile_entries[entry].frame_ms += (sample.end - sample.start) / 1000000.0f;
+        stack.push_back(std::make_pair(entry, sample.end));
+    }
+    for (ProfileEntry& entry : profile_entries) {
+        entry.average_ms += (entry.frame_ms - entry.average_ms) * PROFILE_SMOOTHING;
+    }
+}
+
+void profile_render_entries(int parent, uint32_t thread, unsigned int depth, float x, float* y) {
+    for (unsigned int i = 0; i < profile_entries.size(); i++) {
+        const ProfileEntry& entry = profile_entries[i];
+        if (entry.parent != parent || entry.thread != thread) {
+            continue;
+        }
+
+        char line[64];
+        snprintf(line, sizeof(line), "%*s%-*.*s %6.2f", depth * 2, "", 22 - (depth * 2), 22 - (depth * 2), entry.name, entry.average_ms);
+        font_hack_10pt.render_text(line, x, *y, glm::vec3(1.0f, 1.0f, 1.0f));
+        *y += 10.0f;
+        profile_render_entries(i, thread, depth + 1, x, y);
+    }
+}
+
+void profile_render_breakdown(float x, float y) {
+    for (uint32_t thread = 0; thread <= PROFILE_GPU_THREAD; thread++) {
+        bool has_entries = false;
+        for (const ProfileEntry& entry : profile_entries) {
+            has_entries = has_entries || entry.thread == thread;
+        }
+        if (!has_entries) {
+            continue;
+        }
+
+        const char* thread_name = profile_thread_names[thread] != nullptr ? profile_thread_names[thread] : "thread";
+        font_hack_10pt.render_text(arena_printf("%s ms", thread_name), x, y, glm::vec3(1.0f, 1.0f, 0.0f));
+        y += 10.0f;
+        profile_render_entries(-1, thread, 1, x, &y);
+    }
+}
+
+bool profile_export_trace(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        printf("Unable to write profile trace to %s\n", path.c_str());
+        return false;
+    }
+
+    char buffer[65536];
+    rapidjson::FileWriteStream stream(file, buffer, sizeof(buffer));
+    rapidjson::Writer<rapidjson::FileWriteStream> writer(stream);
+
+    writer.StartObject();
+    writer.Key("displayTimeUnit");
+    writer.String("ms");
+    writer.Key("traceEvents");
+    writer.StartArray();
+
+    for (uint32_t thread = 0; thread <= PROFILE_GPU_THREAD; thread++) {
+        if (profile_thread_names[thread] == nullptr) {
+            continue;
+        }
+        writer.StartObject();
+        writer.Key("name");
+        writer.String("thread_name");
+        writer.Key("ph");
+        writer.String("M");
+        writer.Key("pid");
+        writer.Uint(0);
+        writer.Key("tid");
+        writer.Uint(thread);
+        writer.Key("args");
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(profile_thread_names[thread]);
+        writer.EndObject();
+        writer.EndObject();
+    }
+
+    uint64_t write_index = profile_write_index.load(std::memory_order_acquire);
+    uint64_t first_index = write_index > PROFILE_RING_SIZE ? write_index - PROFILE_RING_SIZE : 0;
+    unsigned int sample_count = 0;
+    for (uint64_t index = first_index; index < write_index; index++) {
+        ProfileSample sample;
+        if (!profile_read(index, &sample)) {
+            continue;
+        }
+
+        // trace timestamps are in microseconds
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(sample.name);
+        writer.Key("ph");
+        writer.String("X");
+        writer.Key("ts");
+        writer.Double(sample.start / 1000.0);
+        writer.Key("dur");
+        writer.Double((sample.end - sample.start) / 1000.0);
+        writer.Key("pid");
+        writer.Uint(0);
+        writer.Key("tid");
+        writer.Uint(sample.thread);
+        writer.EndObject();
+        sample_count++;
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+    stream.Flush();
+    fclose(file);
+
+    printf("Wrote %u profile samples to %s\n", sample_count, path.c_str());
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// a frame profiler, scoped CPU timers and GL timer queries write samples into one ring buffer that
+// the on-screen breakdown and the trace export read from
+// names have to outlive the profiler, so they're always string literals
+
+extern bool profile_enabled;
+// keeps track of the innermost scope on each thread without timing anything, so allocations can be put down to it
+extern bool profile_track_scopes;
+
+// times the enclosing scope, with the profiler and scope tracking off this is a single branch
+struct ProfileScope {
+    const char* name;
+    const char* parent;
+    bool timed;
+    uint64_t start;
+
+    ProfileScope(const char* scope_name) {
+        name = nullptr;
+        if (profile_enabled || profile_track_scopes) {
+            begin(scope_name);
+        }
+    }
+    ~ProfileScope() {
+        if (name != nullptr) {
+            end();
+        }
+    }
+    void begin(const char* scope_name);
+    void end();
+};
+
+// the timer queries need the GL context, headless runs only time the CPU
+void profile_init(bool gpu_queries);
+// the innermost scope on the calling thread, or nullptr outside of every scope
+const char* profile_current_scope();
+void profile_quit();
+// names the calling thread in the breakdown and the trace
+void profile_thread_name(const char* name);
+
+// GPU passes don't nest, beginning one ends the last
+void profile_gpu_begin(const char* name);
+void profile_gpu_end();
+
+// once per frame on the main thread, collects the timer queries that are ready and updates the breakdown
+void profile_frame_end();
+void profile_render_breakdown(float x, float y);
+// writes every sample still in the ring buffer as Chrome trace events, for chrome://tracing or Perfetto
+bool profile_export_trace(const std::string& path);
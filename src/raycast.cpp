@@ -1,7 +1,12 @@
 #include "raycast.hpp"
 
-#include <map>
+#include "profile.hpp"
+#include "stats.hpp"
+#include "arena.hpp"
+
+#include <algorithm>
 #include <cstdio>
+#include <utility>
 
 std::vector<RaycastPlane> raycast_planes;
 
@@ -11,15 +16,37 @@ unsigned int raycast_add_plane(RaycastPlane plane) {
     return raycast_planes.size() - 1;
 }
 
+// the point is already known to be on the plane, this checks that it's inside of the quad
+bool raycast_plane_contains(const RaycastPlane& raycast_plane, glm::vec3 point) {
+    glm::vec3 b_minus_a = raycast_plane.b - raycast_plane.a;
+    float a_dot_b_minus_a = glm::dot(raycast_plane.a, b_minus_a);
+    float i_dot_b_minus_a = glm::dot(point, b_minus_a);
+    float b_dot_b_minus_a = glm::dot(raycast_plane.b, b_minus_a);
+
+    if (a_dot_b_minus_a > i_dot_b_minus_a || i_dot_b_minus_a > b_dot_b_minus_a) {
+        return false;
+    }
+
+    glm::vec3 d_minus_a = raycast_plane.d - raycast_plane.a;
+    float a_dot_d_minus_a = glm::dot(raycast_plane.a, d_minus_a);
+    float i_dot_d_minus_a = glm::dot(point, d_minus_a);
+    float d_dot_d_minus_a = glm::dot(raycast_plane.d, d_minus_a);
+
+    return a_dot_d_minus_a <= i_dot_d_minus_a && i_dot_d_minus_a <= d_dot_d_minus_a;
+}
+
 RaycastResult raycast_cast(glm::vec3 origin, glm::vec3 direction, float range, bool ignore_enemies) {
-    // using multimap so that intersect distances are sorted in order of shortest to furthest distance
-    std::multimap<float, unsigned int> intersect_distances;
+    ProfileScope profile_scope("raycast_cast");
+    // sorted shortest to furthest once they're all found, ties go to the lower plane like they did in a multimap
+    FrameVector<std::pair<float, unsigned int>> intersect_distances;
+    unsigned int planes_tested = 0;
     for (unsigned int plane = 0; plane < raycast_planes.size(); plane++) {
         const RaycastPlane& raycast_plane = raycast_planes[plane];
 
         if (!raycast_plane.enabled || (ignore_enemies && raycast_plane.type == PLANE_TYPE_ENEMY)) {
             continue;
         }
+        planes_tested++;
 
         // if normal and direction are perpendicular, then ray is parallel to plane
         if (glm::dot(direction, raycast_plane.normal) == 0.0f) {
@@ -35,29 +62,18 @@ RaycastResult raycast_cast(glm::vec3 origin, glm::vec3 direction, float range, b
         }
 
         if (intersect_distance <= range) {
-            intersect_distances.insert(std::pair<float, unsigned int>(intersect_distance, plane));
+            intersect_distances.push_back(std::pair<float, unsigned int>(intersect_distance, plane));
         }
     }
+    stats_add(STAT_RAYCASTS, 1);
+    stats_add(STAT_RAYCAST_PLANES, planes_tested);
+    std::sort(intersect_distances.begin(), intersect_distances.end());
 
-    for (std::multimap<float, unsigned int>::iterator itr = intersect_distances.begin(); itr != intersect_distances.end(); ++itr) {
+    for (FrameVector<std::pair<float, unsigned int>>::iterator itr = intersect_distances.begin(); itr != intersect_distances.end(); ++itr) {
         const RaycastPlane& raycast_plane = raycast_planes[itr->second];
         glm::vec3 intersect_point = origin + (direction * itr->first);
 
-        glm::vec3 b_minus_a = raycast_plane.b - raycast_plane.a;
-        float a_dot_b_minus_a = glm::dot(raycast_plane.a, b_minus_a);
-        float i_dot_b_minus_a = glm::dot(intersect_point, b_minus_a);
-        float b_dot_b_minus_a = glm::dot(raycast_plane.b, b_minus_a);
-
-        if (a_dot_b_minus_a > i_dot_b_minus_a || i_dot_b_minus_a > b_dot_b_minus_a) {
-            continue;
-        }
-
-        glm::vec3 d_minus_a = raycast_plane.d - raycast_plane.a;
-        float a_dot_d_minus_a = glm::dot(raycast_plane.a, d_minus_a);
-        float i_dot_d_minus_a = glm::dot(intersect_point, d_minus_a);
-        float d_dot_d_minus_a = glm::dot(raycast_plane.d, d_minus_a);
-
-        if (a_dot_d_minus_a > i_dot_d_minus_a || i_dot_d_minus_a > d_dot_d_minus_a) {
+        if (!raycast_plane_contains(raycast_plane, intersect_point)) {
             continue;
         }
 
@@ -75,6 +91,33 @@ RaycastResult raycast_cast(glm::vec3 origin, glm::vec3 direction, float range, b
     };
 }
 
+bool raycast_is_occluded(glm::vec3 from, glm::vec3 to) {
+    // any hit will do, so nothing gets sorted, and there's no profiling or stats since this runs on several threads at once
+    glm::vec3 direction = to - from;
+    for (const RaycastPlane& raycast_plane : raycast_planes) {
+        if (!raycast_plane.enabled || raycast_plane.type != PLANE_TYPE_LEVEL) {
+            continue;
+        }
+
+        float direction_dot_normal = glm::dot(direction, raycast_plane.normal);
+        if (direction_dot_normal == 0.0f) {
+            continue;
+        }
+
+        // as a fraction of the way from from to to
+        float intersect_time = (glm::dot(raycast_plane.normal, raycast_plane.a) - glm::dot(from, raycast_plane.normal)) / direction_dot_normal;
+        if (intersect_time <= 0.0f || intersect_time >= 1.0f) {
+            continue;
+        }
+
+        if (raycast_plane_contains(raycast_plane, from + (direction * intersect_time))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 float raycast_cast2d(glm::vec2 a_origin, glm::vec2 a_direction, glm::vec2 b_origin, glm::vec2 b_direction) {
     glm::vec2 b_minus_a = b_origin - a_origin;
     float a_direction_cross_b_direction = (a_direction.x * b_direction.y) - (a_direction.y * b_direction.x);
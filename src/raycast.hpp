@@ -29,4 +29,7 @@ extern std::vector<RaycastPlane> raycast_planes;
 
 unsigned int raycast_add_plane(RaycastPlane plane);
 RaycastResult raycast_cast(glm::vec3 origin, glm::vec3 direction, float range, bool ignore_enemies);
+// whether any enabled level plane crosses the segment between the two points, enemies don't block it
+// only reads raycast_planes, so it's safe to call from several threads as long as nothing adds planes meanwhile
+bool raycast_is_occluded(glm::vec3 from, glm::vec3 to);
 float raycast_cast2d(glm::vec2 a_origin, glm::vec2 a_direction, glm::vec2 b_origin, glm::vec2 b_direction);
@@ -0,0 +1,174 @@
+#include "replay.hpp"
+
+#include "input.hpp"
+#include "globals.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+const char REPLAY_MAGIC[4] = { 'Z', 'G', 'R', 'P' };
+const uint32_t REPLAY_VERSION = 1;
+
+struct ReplayHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;
+    uint32_t tick_rate;
+    uint32_t tick_count;
+    uint32_t level_path_length;
+};
+
+// actions packed into bitmasks, 36 bytes a tick
+struct ReplayTick {
+    uint32_t pressed;
+    uint32_t just_pressed;
+    uint32_t just_released;
+    float mouse_raw_xrel;
+    float mouse_raw_yrel;
+    float mouse_raw_x;
+    float mouse_raw_y;
+    float mouse_x;
+    float mouse_y;
+};
+
+static_assert(INPUT_COUNT <= 32, "replay ticks store the actions as 32 bit masks");
+
+ReplayMode replay_mode = REPLAY_OFF;
+FILE* replay_file = NULL;
+std::vector<ReplayTick> replay_ticks;
+unsigned int replay_tick_index = 0;
+
+bool replay_record_begin(const std::string& path, unsigned int seed, const std::string& level_path) {
+    replay_file = fopen(path.c_str(), "wb");
+    if (replay_file == NULL) {
+        printf("Unable to open replay %s for writing\n", path.c_str());
+        return false;
+    }
+
+    ReplayHeader header = {
+        .magic = { REPLAY_MAGIC[0], REPLAY_MAGIC[1], REPLAY_MAGIC[2], REPLAY_MAGIC[3] },
+        .version = REPLAY_VERSION,
+        .seed = seed,
+        .tick_rate = tick_rate,
+        // filled in by replay_end
+        .tick_count = 0,
+        .level_path_length = (uint32_t)level_path.length()
+    };
+    fwrite(&header, sizeof(header), 1, replay_file);
+    fwrite(level_path.c_str(), 1, level_path.length(), replay_file);
+
+    replay_mode = REPLAY_RECORD;
+    replay_tick_index = 0;
+    return true;
+}
+
+bool replay_play_begin(const std::string& path, unsigned int* seed, std::string* level_path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        printf("Unable to open replay %s\n", path.c_str());
+        return false;
+    }
+
+    ReplayHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic[0] != REPLAY_MAGIC[0] || header.magic[1] != REPLAY_MAGIC[1] ||
+        header.magic[2] != REPLAY_MAGIC[2] || header.magic[3] != REPLAY_MAGIC[3]) {
+        printf("%s is not a replay\n", path.c_str());
+        fclose(file);
+        return false;
+    }
+    if (header.version != REPLAY_VERSION) {
+        printf("Replay %s is version %u, expected %u\n", path.c_str(), header.version, REPLAY_VERSION);
+        fclose(file);
+        return false;
+    }
+
+    std::string recorded_level_path(header.level_path_length, '\0');
+    replay_ticks.resize(header.tick_count);
+    bool success = fread(&recorded_level_path[0], 1, header.level_path_length, file) == header.level_path_length &&
+                   fread(replay_ticks.data(), sizeof(ReplayTick), header.tick_count, file) == header.tick_count;
+    fclose(file);
+    if (!success) {
+        printf("Replay %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    *seed = header.seed;
+    *level_path = recorded_level_path;
+    tick_rate = header.tick_rate;
+    replay_mode = REPLAY_PLAY;
+    replay_tick_index = 0;
+    return true;
+}
+
+void replay_end() {
+    if (replay_mode == REPLAY_RECORD) {
+        uint32_t tick_count = replay_tick_index;
+        fseek(replay_file, offsetof(ReplayHeader, tick_count), SEEK_SET);
+        fwrite(&tick_count, sizeof(tick_count), 1, replay_file);
+        fclose(replay_file);
+        replay_file = NULL;
+        printf("Recorded %u ticks\n", replay_tick_index);
+    } else if (replay_mode == REPLAY_PLAY) {
+        printf("Replayed %u of %zu ticks\n", replay_tick_index, replay_ticks.size());
+    }
+    replay_mode = REPLAY_OFF;
+}
+
+bool replay_tick() {
+    if (replay_mode == REPLAY_RECORD) {
+        ReplayTick tick = {
+            .pressed = 0,
+            .just_pressed = 0,
+            .just_released = 0,
+            .mouse_raw_xrel = input.mouse_raw_xrel,
+            .mouse_raw_yrel = input.mouse_raw_yrel,
+            .mouse_raw_x = input.mouse_raw_x,
+            .mouse_raw_y = input.mouse_raw_y,
+            .mouse_x = input.mouse_x,
+            .mouse_y = input.mouse_y
+        };
+        for (unsigned int i = 0; i < INPUT_COUNT; i++) {
+            tick.pressed |= (uint32_t)input.is_action_pressed[i] << i;
+            tick.just_pressed |= (uint32_t)input.is_action_just_pressed[i] << i;
+            tick.just_released |= (uint32_t)input.is_action_just_released[i] << i;
+        }
+        fwrite(&tick, sizeof(tick), 1, replay_file);
+        replay_tick_index++;
+    } else if (replay_mode == REPLAY_PLAY) {
+        if (replay_tick_index == replay_ticks.size()) {
+            return false;
+        }
+
+        const ReplayTick& tick = replay_ticks[replay_tick_index];
+        for (unsigned int i = 0; i < INPUT_COUNT; i++) {
+            input.is_action_pressed[i] = (tick.pressed >> i) & 1;
+            input.is_action_just_pressed[i] = (tick.just_pressed >> i) & 1;
+            input.is_action_just_released[i] = (tick.just_released >> i) & 1;
+        }
+        input.mouse_raw_xrel = tick.mouse_raw_xrel;
+        input.mouse_raw_yrel = tick.mouse_raw_yrel;
+        input.mouse_raw_x = tick.mouse_raw_x;
+        input.mouse_raw_y = tick.mouse_raw_y;
+        input.mouse_x = tick.mouse_x;
+        input.mouse_y = tick.mouse_y;
+        replay_tick_index++;
+    }
+
+    return true;
+}
+
+bool replay_finished() {
+    return replay_mode == REPLAY_PLAY && replay_tick_index == replay_ticks.size();
+}
+
+void replay_rewind() {
+    if (replay_mode == REPLAY_PLAY) {
+        replay_tick_index = 0;
+    }
+}
+
+unsigned int replay_tick_count() {
+    return replay_ticks.size();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+// records the input each simulation tick saw, with the RNG seed and level it started from, so a run can be
+// played back exactly, ticks are fixed length so nothing else about timing needs to be stored
+
+enum ReplayMode {
+    REPLAY_OFF,
+    REPLAY_RECORD,
+    REPLAY_PLAY
+};
+
+extern ReplayMode replay_mode;
+
+bool replay_record_begin(const std::string& path, unsigned int seed, const std::string& level_path);
+// reads the whole recording up front so playback doesn't touch the disk, and sets tick_rate to the recorded one
+bool replay_play_begin(const std::string& path, unsigned int* seed, std::string* level_path);
+// closes the recording, or reports how far playback got
+void replay_end();
+
+// called before every tick, records the input or replaces it with the recorded input
+// returns false once playback has run out of ticks
+bool replay_tick();
+bool replay_finished();
+// starts playback over from the first tick
+void replay_rewind();
+unsigned int replay_tick_count();
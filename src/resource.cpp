@@ -1,136 +1,582 @@
 #include "resource.hpp"
 
 #include "globals.hpp"
+#include "shader.hpp"
+#include "file.hpp"
+#include "pack.hpp"
 
 #include <glad/glad.h>
 #include <stb_image.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <string>
 
-struct ResourceLoadInput {
-    std::string path;
+const int TEXTURE_SIZE = 128;
+
+unsigned int cache_hits = 0;
+unsigned long resource_frame = 0;
+
+const char* RESOURCE_CACHE_PATH = "./cache";
+const uint32_t RESOURCE_CACHE_MAGIC = 0x4354475a; // "ZGTC"
+const uint32_t RESOURCE_CACHE_VERSION = 1;
+
+struct ResourceCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t mip_count;
+    uint32_t frame_count;
+    uint32_t data_offset;
+};
+
+struct ResourceMip {
+    uint32_t width;
+    uint32_t height;
+    // offset is relative to the start of the pixel data
+    uint64_t offset;
+    uint64_t size;
+};
+
+// CPU side of a texture, pixel_data either points into pixels or into the mapped cache file
+struct ResourceData {
+    bool success;
+    bool from_cache;
     unsigned int width;
     unsigned int height;
-    unsigned int num_textures;
-    unsigned int format;
-    unsigned int wrap_s;
-    unsigned int wrap_t;
-    unsigned int min_filter;
-    unsigned int mag_filter;
-    bool generate_mipmaps;
+    unsigned int layers;
+    std::vector<ResourceMip> mips;
+    std::vector<AtlasFrame> frames;
+    std::vector<unsigned char> pixels;
+    MappedFile cache_file;
+    const unsigned char* pixel_data;
 };
 
-const int TEXTURE_SIZE = 128;
+// the parts of a table entry only this file needs, residency is only touched on the main thread
+struct ResourceEntry {
+    ResourceLoadInput input;
+    ResourceData data;
+    unsigned int mip_count;
+    // for evicting the least recently used texture first
+    unsigned long last_used;
+};
+
+// both are filled in as the handles below are initialized, so they have to be defined first
+std::vector<ResourceInfo> resource_table;
+std::vector<ResourceEntry> resource_entries;
 
-unsigned int resource_textures;
-unsigned int resource_player_pistol;
-unsigned int resource_bullet_hole;
-unsigned int resource_wasp;
-unsigned int resource_wasp_bullet_hole;
-unsigned int resource_test;
+std::string resource_cache_path(const std::string& path) {
+    std::string name = path.substr(0, 2) == "./" ? path.substr(2) : path;
+    for (unsigned int i = 0; i < name.length(); i++) {
+        if (name[i] == '/' || name[i] == '\\') {
+            name[i] = '_';
+        }
+    }
 
-std::map<unsigned int, glm::ivec2> resource_extents;
+    return std::string(RESOURCE_CACHE_PATH) + "/" + name + ".tex";
+}
 
-bool success = true;
+bool resource_cache_read(const std::string& path, uint64_t key, ResourceData* data) {
+    if (!file_map(path, &data->cache_file)) {
+        return false;
+    }
 
-void resource_load(unsigned int* id, ResourceLoadInput input) {
-    glGenTextures(1, id);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, *id);
+    const MappedFile& file = data->cache_file;
+    ResourceCacheHeader header;
+    bool is_valid = file.size >= sizeof(ResourceCacheHeader);
+    if (is_valid) {
+        memcpy(&header, file.data, sizeof(ResourceCacheHeader));
+        size_t tables_size = sizeof(ResourceCacheHeader) + (header.frame_count * sizeof(AtlasFrame)) + (header.mip_count * sizeof(ResourceMip));
+        // a different key means the source images or the load parameters changed since the cache was written
+        is_valid = header.magic == RESOURCE_CACHE_MAGIC && header.version == RESOURCE_CACHE_VERSION && header.key == key &&
+                   header.mip_count > 0 && tables_size <= header.data_offset && header.data_offset <= file.size;
+    }
+    if (is_valid) {
+        size_t offset = sizeof(ResourceCacheHeader);
+        data->frames.resize(header.frame_count);
+        if (header.frame_count > 0) {
+            memcpy(&data->frames[0], file.data + offset, header.frame_count * sizeof(AtlasFrame));
+        }
+        offset += header.frame_count * sizeof(AtlasFrame);
+        data->mips.resize(header.mip_count);
+        memcpy(&data->mips[0], file.data + offset, header.mip_count * sizeof(ResourceMip));
+
+        for (const ResourceMip& mip : data->mips) {
+            if (mip.offset + mip.size > file.size - header.data_offset) {
+                is_valid = false;
+            }
+        }
+    }
+    if (!is_valid) {
+        file_unmap(&data->cache_file);
+        data->frames.clear();
+        data->mips.clear();
+        return false;
+    }
+
+    data->width = header.width;
+    data->height = header.height;
+    data->layers = header.layers;
+    data->pixel_data = file.data + header.data_offset;
+    return true;
+}
+
+void resource_cache_write(const std::string& path, uint64_t key, const ResourceData& data) {
+    ResourceCacheHeader header = {
+        .magic = RESOURCE_CACHE_MAGIC,
+        .version = RESOURCE_CACHE_VERSION,
+        .key = key,
+        .width = data.width,
+        .height = data.height,
+        .layers = data.layers,
+        .mip_count = (uint32_t)data.mips.size(),
+        .frame_count = (uint32_t)data.frames.size(),
+        .data_offset = 0
+    };
+    size_t tables_size = sizeof(ResourceCacheHeader) + (data.frames.size() * sizeof(AtlasFrame)) + (data.mips.size() * sizeof(ResourceMip));
+    // keep the pixel data aligned so that it can be handed to GL straight out of the mapping
+    header.data_offset = (tables_size + 15) & ~15;
+
+    std::vector<unsigned char> bytes(header.data_offset + data.pixels.size(), 0);
+    size_t offset = 0;
+    memcpy(&bytes[offset], &header, sizeof(ResourceCacheHeader));
+    offset += sizeof(ResourceCacheHeader);
+    if (!data.frames.empty()) {
+        memcpy(&bytes[offset], &data.frames[0], data.frames.size() * sizeof(AtlasFrame));
+    }
+    offset += data.frames.size() * sizeof(AtlasFrame);
+    memcpy(&bytes[offset], &data.mips[0], data.mips.size() * sizeof(ResourceMip));
+    memcpy(&bytes[header.data_offset], &data.pixels[0], data.pixels.size());
+
+    if (!file_make_directory(RESOURCE_CACHE_PATH) || !file_write_atomic(path, bytes)) {
+        printf("Unable to write texture cache %s\n", path.c_str());
+    }
+}
+
+void resource_generate_mips(ResourceData* data, unsigned int channels, unsigned int max_level) {
+    // 2x2 box filter each layer, this is what glGenerateMipmap does on most drivers
+    while (data->mips.size() <= max_level) {
+        ResourceMip parent = data->mips.back();
+        if (parent.width == 1 && parent.height == 1) {
+            break;
+        }
+
+        ResourceMip mip;
+        mip.width = std::max(1u, parent.width / 2);
+        mip.height = std::max(1u, parent.height / 2);
+        mip.offset = data->pixels.size();
+        mip.size = mip.width * mip.height * channels * data->layers;
+        data->pixels.resize(data->pixels.size() + mip.size);
 
-    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, input.format, input.width, input.height, input.num_textures, 0, input.format, GL_UNSIGNED_BYTE, NULL);
+        for (unsigned int layer = 0; layer < data->layers; layer++) {
+            const unsigned char* src = &data->pixels[parent.offset + (layer * parent.width * parent.height * channels)];
+            unsigned char* dst = &data->pixels[mip.offset + (layer * mip.width * mip.height * channels)];
+            for (unsigned int y = 0; y < mip.height; y++) {
+                unsigned int y0 = std::min(y * 2, parent.height - 1);
+                unsigned int y1 = std::min((y * 2) + 1, parent.height - 1);
+                for (unsigned int x = 0; x < mip.width; x++) {
+                    unsigned int x0 = std::min(x * 2, parent.width - 1);
+                    unsigned int x1 = std::min((x * 2) + 1, parent.width - 1);
+                    for (unsigned int c = 0; c < channels; c++) {
+                        unsigned int sum = src[(((y0 * parent.width) + x0) * channels) + c] + src[(((y0 * parent.width) + x1) * channels) + c] +
+                                           src[(((y1 * parent.width) + x0) * channels) + c] + src[(((y1 * parent.width) + x1) * channels) + c];
+                        dst[(((y * mip.width) + x) * channels) + c] = (sum + 2) / 4;
+                    }
+                }
+            }
+        }
+
+        data->mips.push_back(mip);
+    }
+}
+
+// CPU only, reads the source images and either maps the cached texture or decodes them
+void resource_decode_texture(const ResourceLoadInput& input, ResourceData* data) {
+    // a texture that was unloaded is decoded again into the same slot
+    data->success = false;
+    data->from_cache = false;
+    data->mips.clear();
+    data->frames.clear();
+
+    // the cache key covers the load parameters and the bytes of every source image
+    uint64_t key = file_hash(&RESOURCE_CACHE_VERSION, sizeof(RESOURCE_CACHE_VERSION));
+    unsigned int params[6] = { input.width, input.height, input.num_textures, input.format, input.generate_mipmaps, input.pack_atlas };
+    key = file_hash(params, sizeof(params), key);
+
+    std::vector<std::vector<unsigned char>> sources(input.num_textures);
     for (unsigned int i = 0; i < input.num_textures; i++) {
-        int width, height, num_channels;
         std::string path = (input.path + "/" + std::to_string(i) + ".png");
-        unsigned char* data = stbi_load(path.c_str(), &width, &height, &num_channels, 0);
-        if (!data) {
+        if (!pack_read(path, &sources[i]) || sources[i].empty()) {
             printf("Unable to load texture %s\n", path.c_str());
-            success = false;
             return;
         }
+        key = file_hash(&sources[i][0], sources[i].size(), key);
+    }
+
+    std::string cache_path = resource_cache_path(input.path);
+    if (texture_cache && resource_cache_read(cache_path, key, data)) {
+        data->from_cache = true;
+        data->success = true;
+        return;
+    }
+
+    unsigned int channels = input.format == GL_RGBA ? 4 : 3;
+    std::vector<unsigned char*> images;
+    for (unsigned int i = 0; i < input.num_textures; i++) {
+        int width, height, num_channels;
+        unsigned char* image = stbi_load_from_memory(&sources[i][0], sources[i].size(), &width, &height, &num_channels, channels);
+        if (!image) {
+            printf("Unable to load texture %s/%u.png\n", input.path.c_str(), i);
+            break;
+        }
         if ((unsigned int)width != input.width || (unsigned int)height != input.height) {
-            printf("width and height don't match texture %s\n", path.c_str());
-            success = false;
-            return;
+            printf("width and height don't match texture %s/%u.png\n", input.path.c_str(), i);
+            stbi_image_free(image);
+            break;
         }
-        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, input.width, input.height, 1, input.format, GL_UNSIGNED_BYTE, data);
-        stbi_image_free(data);
+        images.push_back(image);
+    }
+    if (images.size() != input.num_textures) {
+        for (unsigned char* image : images) {
+            stbi_image_free(image);
+        }
+        return;
     }
 
-    if (input.generate_mipmaps) {
-        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    unsigned int max_mip_level = 0;
+    if (input.pack_atlas) {
+        Atlas atlas;
+        atlas_pack(&atlas, images, input.width, input.height);
+        data->width = atlas.width;
+        data->height = atlas.height;
+        data->layers = 1;
+        data->pixels.swap(atlas.pixels);
+        data->frames = atlas.frames;
+        // frames are only padded far enough apart for the first few mip levels
+        max_mip_level = input.generate_mipmaps ? ATLAS_MIP_LEVELS : 0;
+    } else {
+        data->width = input.width;
+        data->height = input.height;
+        data->layers = input.num_textures;
+        size_t layer_size = input.width * input.height * channels;
+        data->pixels.resize(layer_size * input.num_textures);
+        for (unsigned int i = 0; i < input.num_textures; i++) {
+            memcpy(&data->pixels[i * layer_size], images[i], layer_size);
+        }
+        max_mip_level = input.generate_mipmaps ? 32 : 0;
+    }
+    for (unsigned char* image : images) {
+        stbi_image_free(image);
     }
 
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, input.wrap_s);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, input.wrap_t);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, input.min_filter);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, input.mag_filter);
+    data->mips.push_back({
+        .width = data->width,
+        .height = data->height,
+        .offset = 0,
+        .size = data->pixels.size()
+    });
+    resource_generate_mips(data, channels, max_mip_level);
 
-    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    if (texture_cache) {
+        resource_cache_write(cache_path, key, *data);
+    }
 
-    resource_extents.insert(std::pair<unsigned int, glm::ivec2>(*id, glm::ivec2(input.width / 2, input.height / 2)));
+    data->pixel_data = &data->pixels[0];
+    data->success = true;
 }
 
-bool resource_load_all() {
-    resource_load(&resource_textures, {
-        .path = "./res/texture",
-        .width = TEXTURE_SIZE,
-        .height = TEXTURE_SIZE,
-        .num_textures = NUM_TEXTURES,
-        .format = GL_RGB,
-        .wrap_s = GL_REPEAT,
-        .wrap_t = GL_REPEAT,
-        .min_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .generate_mipmaps = true
-    });
-    resource_load(&resource_player_pistol, {
-        .path = "./res/guns/pistol",
-        .width = SCREEN_WIDTH,
-        .height = SCREEN_HEIGHT,
-        .num_textures = 31,
-        .format = GL_RGBA,
-        .wrap_s = GL_CLAMP_TO_EDGE,
-        .wrap_t = GL_CLAMP_TO_EDGE,
-        .min_filter = GL_NEAREST,
-        .mag_filter = GL_NEAREST,
-        .generate_mipmaps = false
-    });
-    resource_load(&resource_bullet_hole, {
-        .path = "./res/bullet_hole",
-        .width = 16,
-        .height = 16,
-        .num_textures = 1,
-        .format = GL_RGBA,
-        .wrap_s = GL_CLAMP_TO_EDGE,
-        .wrap_t = GL_CLAMP_TO_EDGE,
-        .min_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .generate_mipmaps = true
-    });
-    resource_load(&resource_wasp_bullet_hole, {
-        .path = "./res/alien_bullet_hole",
-        .width = 16,
-        .height = 16,
-        .num_textures = 3,
-        .format = GL_RGBA,
-        .wrap_s = GL_CLAMP_TO_EDGE,
-        .wrap_t = GL_CLAMP_TO_EDGE,
-        .min_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .generate_mipmaps = true
+size_t resource_upload_texture(unsigned int id, const ResourceLoadInput& input, const ResourceData& data) {
+    unsigned int target = input.pack_atlas ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(target, id);
+
+    // rows of the smaller RGB mips aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    size_t vram_size = 0;
+    for (unsigned int level = 0; level < data.mips.size(); level++) {
+        const ResourceMip& mip = data.mips[level];
+        if (target == GL_TEXTURE_2D) {
+            glTexImage2D(GL_TEXTURE_2D, level, input.format, mip.width, mip.height, 0, input.format, GL_UNSIGNED_BYTE, data.pixel_data + mip.offset);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, input.format, mip.width, mip.height, data.layers, 0, input.format, GL_UNSIGNED_BYTE, data.pixel_data + mip.offset);
+        }
+        vram_size += mip.size;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, data.mips.size() - 1);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, input.wrap_s);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, input.wrap_t);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, input.min_filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, input.mag_filter);
+
+    glBindTexture(target, 0);
+
+    if (input.pack_atlas && trace_loading) {
+        float mip_scale = input.generate_mipmaps ? 4.0f / 3.0f : 1.0f;
+        printf("Packed %s into a %ux%u atlas, %.2f MB instead of %.2f MB\n", input.path.c_str(), data.width, data.height,
+               vram_size / (1024.0f * 1024.0f), (input.width * input.height * 4 * input.num_textures * mip_scale) / (1024.0f * 1024.0f));
+    }
+
+    return vram_size;
+}
+
+// respecifying every level as empty frees the storage but keeps the name
+void resource_unload_texture(unsigned int id, const ResourceLoadInput& input, unsigned int mip_count) {
+    unsigned int target = input.pack_atlas ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY;
+    glBindTexture(target, id);
+    for (unsigned int level = 0; level < mip_count; level++) {
+        if (target == GL_TEXTURE_2D) {
+            glTexImage2D(GL_TEXTURE_2D, level, input.format, 0, 0, 0, input.format, GL_UNSIGNED_BYTE, NULL);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, input.format, 0, 0, 0, 0, input.format, GL_UNSIGNED_BYTE, NULL);
+        }
+    }
+    glBindTexture(target, 0);
+}
+
+ResourceHandle resource_load(const ResourceLoadInput& input) {
+    resource_table.push_back({
+        .texture = 0,
+        .extents = glm::ivec2(input.width / 2, input.height / 2),
+        .layers = input.pack_atlas ? 1 : input.num_textures,
+        .format = input.format,
+        .byte_size = 0,
+        .resident = false,
+        .references = 0,
+        .frames = std::vector<AtlasFrame>()
     });
-    resource_load(&resource_wasp, {
-        .path = "./res/wasp",
-        .width = 181,
-        .height = 136,
-        .num_textures = 21,
-        .format = GL_RGBA,
-        .wrap_s = GL_CLAMP_TO_EDGE,
-        .wrap_t = GL_CLAMP_TO_EDGE,
-        .min_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
-        .generate_mipmaps = true
+    resource_entries.push_back({
+        .input = input,
+        .data = ResourceData(),
+        .mip_count = 0,
+        .last_used = 0
     });
 
+    return resource_table.size() - 1;
+}
+
+ResourceHandle resource_textures = resource_load({
+    .path = "./res/texture",
+    .width = TEXTURE_SIZE,
+    .height = TEXTURE_SIZE,
+    .num_textures = NUM_TEXTURES,
+    .format = GL_RGB,
+    .wrap_s = GL_REPEAT,
+    .wrap_t = GL_REPEAT,
+    .min_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .generate_mipmaps = true,
+    .pack_atlas = false
+});
+ResourceHandle resource_player_pistol = resource_load({
+    .path = "./res/guns/pistol",
+    .width = SCREEN_WIDTH,
+    .height = SCREEN_HEIGHT,
+    .num_textures = 31,
+    .format = GL_RGBA,
+    .wrap_s = GL_CLAMP_TO_EDGE,
+    .wrap_t = GL_CLAMP_TO_EDGE,
+    .min_filter = GL_NEAREST,
+    .mag_filter = GL_NEAREST,
+    .generate_mipmaps = false,
+    .pack_atlas = true
+});
+ResourceHandle resource_bullet_hole = resource_load({
+    .path = "./res/bullet_hole",
+    .width = 16,
+    .height = 16,
+    .num_textures = 1,
+    .format = GL_RGBA,
+    .wrap_s = GL_CLAMP_TO_EDGE,
+    .wrap_t = GL_CLAMP_TO_EDGE,
+    .min_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .generate_mipmaps = true,
+    .pack_atlas = true
+});
+ResourceHandle resource_wasp_bullet_hole = resource_load({
+    .path = "./res/alien_bullet_hole",
+    .width = 16,
+    .height = 16,
+    .num_textures = 3,
+    .format = GL_RGBA,
+    .wrap_s = GL_CLAMP_TO_EDGE,
+    .wrap_t = GL_CLAMP_TO_EDGE,
+    .min_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .generate_mipmaps = true,
+    .pack_atlas = true
+});
+ResourceHandle resource_wasp = resource_load({
+    .path = "./res/wasp",
+    .width = 181,
+    .height = 136,
+    .num_textures = 21,
+    .format = GL_RGBA,
+    .wrap_s = GL_CLAMP_TO_EDGE,
+    .wrap_t = GL_CLAMP_TO_EDGE,
+    .min_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .mag_filter = GL_NEAREST_MIPMAP_LINEAR,
+    .generate_mipmaps = true,
+    .pack_atlas = true
+});
+
+unsigned int resource_count() {
+    return resource_table.size();
+}
+
+void resource_decode(ResourceHandle handle) {
+    ResourceEntry& entry = resource_entries[handle];
+    resource_decode_texture(entry.input, &entry.data);
+}
+
+void resource_generate_names() {
+    for (ResourceInfo& info : resource_table) {
+        glGenTextures(1, &info.texture);
+    }
+}
+
+bool resource_upload(ResourceHandle handle) {
+    ResourceEntry& entry = resource_entries[handle];
+    ResourceData& data = entry.data;
+    if (!data.success) {
+        return false;
+    }
+
+    ResourceInfo& info = resource_table[handle];
+    info.byte_size = resource_upload_texture(info.texture, entry.input, data);
+    info.layers = data.layers;
+    info.frames = data.frames;
+    info.resident = true;
+    entry.mip_count = data.mips.size();
+    entry.last_used = resource_frame;
+    if (data.from_cache) {
+        cache_hits++;
+        file_unmap(&data.cache_file);
+    }
+    std::vector<unsigned char>().swap(data.pixels);
+
+    return true;
+}
+
+bool resource_load_all() {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    resource_generate_names();
+    bool success = true;
+    for (ResourceHandle handle = 0; handle < resource_table.size(); handle++) {
+        resource_decode(handle);
+        success = resource_upload(handle) && success;
+    }
+
+    float load_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    if (trace_loading) {
+        printf("Loaded textures in %.2f ms, %u from the texture cache\n", load_time, cache_hits);
+    }
+
     return success;
 }
+
+bool resource_make_resident(ResourceHandle handle) {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    resource_decode(handle);
+    bool success = resource_upload(handle);
+    float load_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    if (trace_loading) {
+        printf("Loaded %s in %.2f ms\n", resource_entries[handle].input.path.c_str(), load_time);
+    }
+
+    return success;
+}
+
+void resource_acquire(ResourceHandle handle) {
+    ResourceInfo& info = resource_table[handle];
+    info.references++;
+    resource_entries[handle].last_used = resource_frame;
+    if (!info.resident) {
+        resource_make_resident(handle);
+    }
+}
+
+void resource_release(ResourceHandle handle) {
+    ResourceInfo& info = resource_table[handle];
+    if (info.references > 0) {
+        info.references--;
+    }
+}
+
+void resource_unload(ResourceHandle handle) {
+    ResourceInfo& info = resource_table[handle];
+    ResourceEntry& entry = resource_entries[handle];
+    resource_unload_texture(info.texture, entry.input, entry.mip_count);
+    if (trace_loading) {
+        printf("Unloaded %s, %.2f MB\n", entry.input.path.c_str(), info.byte_size / (1024.0f * 1024.0f));
+    }
+    info.resident = false;
+    info.byte_size = 0;
+}
+
+void resource_collect() {
+    resource_frame++;
+
+    size_t budget = (size_t)texture_budget_mb * 1024 * 1024;
+    size_t resident_size = resource_resident_bytes();
+    while (resident_size > budget) {
+        ResourceHandle oldest = resource_table.size();
+        for (ResourceHandle handle = 0; handle < resource_table.size(); handle++) {
+            const ResourceInfo& info = resource_table[handle];
+            if (info.resident && info.references == 0 && (oldest == resource_table.size() || resource_entries[handle].last_used < resource_entries[oldest].last_used)) {
+                oldest = handle;
+            }
+        }
+        // whatever is left is in use, and can't go over the budget by being unloaded
+        if (oldest == resource_table.size()) {
+            break;
+        }
+
+        resident_size -= resource_table[oldest].byte_size;
+        resource_unload(oldest);
+    }
+}
+
+size_t resource_resident_bytes() {
+    size_t resident_size = 0;
+    for (const ResourceInfo& info : resource_table) {
+        resident_size += info.byte_size;
+    }
+
+    return resident_size;
+}
+
+void resource_print_residency() {
+    unsigned int resident_count = 0;
+    for (const ResourceInfo& info : resource_table) {
+        if (info.resident) {
+            resident_count++;
+        }
+    }
+    printf("%u of %u textures resident, %.2f MB\n", resident_count, (unsigned int)resource_table.size(), resource_resident_bytes() / (1024.0f * 1024.0f));
+    for (ResourceHandle handle = 0; handle < resource_table.size(); handle++) {
+        const ResourceInfo& info = resource_table[handle];
+        printf("  %-26s %s %8.2f MB  %s %2u layers  %u references\n", resource_entries[handle].input.path.c_str(), info.resident ? "resident" : "unloaded",
+               info.byte_size / (1024.0f * 1024.0f), info.format == GL_RGBA ? "RGBA" : "RGB ", info.layers, info.references);
+    }
+}
+
+void resource_bind_sprite(ResourceHandle handle, unsigned int frame) {
+    const ResourceInfo& info = resource_table[handle];
+    const AtlasFrame& atlas_frame = info.frames[frame];
+    glUniform2iv(glGetUniformLocation(billboard_shader, "extents"), 1, glm::value_ptr(info.extents));
+    glUniform4fv(glGetUniformLocation(billboard_shader, "frame_rect"), 1, glm::value_ptr(atlas_frame.uv_rect));
+    glUniform4fv(glGetUniformLocation(billboard_shader, "frame_quad"), 1, glm::value_ptr(atlas_frame.quad_rect));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, info.texture);
+}
@@ -1,14 +1,70 @@
 #pragma once
 
-#include <map>
+#include "atlas.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
-extern unsigned int resource_textures;
-extern unsigned int resource_player_pistol;
-extern unsigned int resource_bullet_hole;
-extern unsigned int resource_wasp;
-extern unsigned int resource_wasp_bullet_hole;
+// handles index the resource table, so looking a texture up is an array access
+typedef unsigned int ResourceHandle;
+
+struct ResourceLoadInput {
+    std::string path;
+    unsigned int width;
+    unsigned int height;
+    unsigned int num_textures;
+    unsigned int format;
+    unsigned int wrap_s;
+    unsigned int wrap_t;
+    unsigned int min_filter;
+    unsigned int mag_filter;
+    bool generate_mipmaps;
+    bool pack_atlas;
+};
+
+// everything known about a texture, the extents are there before it's loaded so the simulation can cull with them
+struct ResourceInfo {
+    unsigned int texture;
+    glm::ivec2 extents;
+    unsigned int layers;
+    unsigned int format;
+    // video memory while it's resident
+    size_t byte_size;
+    bool resident;
+    unsigned int references;
+    std::vector<AtlasFrame> frames;
+};
 
-extern std::map<unsigned int, glm::ivec2> resource_extents;
+extern std::vector<ResourceInfo> resource_table;
 
+extern ResourceHandle resource_textures;
+extern ResourceHandle resource_player_pistol;
+extern ResourceHandle resource_bullet_hole;
+extern ResourceHandle resource_wasp;
+extern ResourceHandle resource_wasp_bullet_hole;
+
+// adds a texture to the table, nothing is read until it's decoded or acquired
+ResourceHandle resource_load(const ResourceLoadInput& input);
+inline const ResourceInfo& resource_info(ResourceHandle handle) {
+    return resource_table[handle];
+}
+
+// decoding only touches files and memory so it can run on a task thread, the rest needs the GL context
+// names are generated up front so that texture ids don't depend on the order uploads happen in
+unsigned int resource_count();
+void resource_decode(ResourceHandle handle);
+void resource_generate_names();
+bool resource_upload(ResourceHandle handle);
 bool resource_load_all();
+
+// textures stay resident while something holds a reference, acquiring one that isn't resident loads it right away
+// unreferenced textures are kept as a cache for as long as they fit in texture_budget_mb, all of this is main thread only
+void resource_acquire(ResourceHandle handle);
+void resource_release(ResourceHandle handle);
+// once a frame, unloads the least recently used unreferenced textures until what's resident fits the budget
+void resource_collect();
+size_t resource_resident_bytes();
+void resource_print_residency();
+void resource_bind_sprite(ResourceHandle handle, unsigned int frame);
@@ -6,35 +6,201 @@
 #include "resource.hpp"
 #include "level.hpp"
 #include "shader.hpp"
+#include "input.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "replay.hpp"
+#include "arena.hpp"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+
+// after a long stall the simulation drops time instead of ticking in a burst that makes the next frame long too
+const unsigned int SCENE_MAX_TICKS_PER_FRAME = 8;
 
 Player player;
+float scene_time_accumulator = 0.0f;
+unsigned int scene_ticks = 0;
 
 void scene_init() {
+    for (EnemySpawn& enemy_spawn : enemy_spawns) {
+        Enemy enemy(enemies.size());
+        enemy.position = enemy_spawn.position;
+        enemy.direction = glm::vec3(enemy_spawn.direction.x, 0.0f, enemy_spawn.direction.y);
+        enemy.previous_position = enemy.position;
+        enemies.push_back(enemy);
+    }
+
+    // everything that grows during play gets its room now, so the game loop doesn't allocate
+    for (Enemy& enemy : enemies) {
+        enemy.bullet_holes.reserve(ENEMY_MAX_BULLET_HOLES);
+    }
+    for (Sector& sector : sectors) {
+        sector.bullet_holes.reserve(LEVEL_MAX_BULLET_HOLES);
+    }
+
+    player.init();
+    scene_time_accumulator = 0.0f;
+    scene_ticks = 0;
+}
+
+void scene_resources(std::vector<ResourceHandle>* handles) {
+    handles->push_back(resource_textures);
+    handles->push_back(resource_bullet_hole);
+    handles->push_back(resource_player_pistol);
+    if (!enemy_spawns.empty()) {
+        handles->push_back(resource_wasp);
+        handles->push_back(resource_wasp_bullet_hole);
+    }
+}
+
+void scene_init_render() {
+    // held for the whole game, enemies are never removed so their sprites are needed until the end
+    std::vector<ResourceHandle> resource_handles;
+    scene_resources(&resource_handles);
+    for (ResourceHandle handle : resource_handles) {
+        resource_acquire(handle);
+    }
+
     glm::ivec2 screen_size = glm::ivec2(SCREEN_WIDTH, SCREEN_HEIGHT);
     glUseProgram(billboard_shader);
-    glUniform1i(glGetUniformLocation(billboard_shader, "u_texture_array"), 0);
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), 0);
+    glUniform1i(glGetUniformLocation(billboard_shader, "u_texture"), 0);
     glUniform1ui(glGetUniformLocation(billboard_shader, "lighting_enabled"), true);
     glUniform2iv(glGetUniformLocation(billboard_shader, "screen_size"), 1, glm::value_ptr(screen_size));
     glUseProgram(ui_shader);
     glUniform2iv(glGetUniformLocation(ui_shader, "screen_size"), 1, glm::value_ptr(screen_size));
+}
 
-    for (EnemySpawn& enemy_spawn : enemy_spawns) {
-        Enemy enemy(enemies.size());
-        enemy.position = enemy_spawn.position;
-        enemy.direction = glm::vec3(enemy_spawn.direction.x, 0.0f, enemy_spawn.direction.y);
-        enemies.push_back(enemy);
+float scene_advance(float frame_time) {
+    arena_reset();
+    float tick_time = 1000.0f / tick_rate;
+    scene_time_accumulator = std::min(scene_time_accumulator + frame_time, tick_time * SCENE_MAX_TICKS_PER_FRAME);
+
+    // the slack keeps float rounding from pushing a tick into the next frame
+    while (scene_time_accumulator + 0.001f >= tick_time) {
+        if (!replay_tick()) {
+            scene_time_accumulator = 0.0f;
+            break;
+        }
+        scene_update(tick_time / 60.0f);
+        // input keeps collecting across frames until a tick has seen it
+        input_prime_state();
+        scene_time_accumulator -= tick_time;
+        scene_ticks++;
     }
 
-    player.init();
+    return std::max(0.0f, scene_time_accumulator / tick_time);
+}
+
+void scene_run_headless(unsigned int ticks) {
+    float tick_time = 1000.0f / tick_rate;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < ticks; i++) {
+        scene_advance(tick_time);
+        stats_frame_end(tick_time);
+    }
+    float run_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    unsigned int enemies_alive = 0;
+    for (const Enemy& enemy : enemies) {
+        if (!enemy.is_dead) {
+            enemies_alive++;
+        }
+    }
+    float game_time = ticks * tick_time;
+    printf("Simulated %u ticks (%.1f s of game time) in %.1f ms, %.0f ticks per second, %.1fx real time\n",
+           ticks, game_time / 1000.0f, run_time, ticks / (run_time / 1000.0f), game_time / run_time);
+    printf("  %zu sectors, %zu raycast planes, %u of %zu enemies alive, player health %u\n",
+           sectors.size(), raycast_planes.size(), enemies_alive, enemies.size(), player.health);
+    printf("  state checksum %08x\n", scene_checksum());
+}
+
+bool scene_check_render_rates(const std::string& level_path, unsigned int seed, unsigned int ticks) {
+    float tick_time = 1000.0f / tick_rate;
+    // frame times in milliseconds, cycled through, the first is one tick a frame like the other headless runs
+    std::vector<std::vector<float>> frame_time_sequences = {
+        { tick_time },
+        { 1000.0f / 30.0f },
+        { 1000.0f / 144.0f },
+        { 1000.0f / 240.0f },
+        { 3.1f, 16.7f, 41.0f, 7.3f, 0.5f, 25.0f, 11.9f }
+    };
+
+    bool rates_match = true;
+    unsigned int first_checksum = 0;
+    for (unsigned int i = 0; i < frame_time_sequences.size(); i++) {
+        const std::vector<float>& frame_times = frame_time_sequences[i];
+        sectors.clear();
+        lights.clear();
+        enemy_spawns.clear();
+        enemies.clear();
+        input = InputState();
+        replay_rewind();
+        srand(seed);
+        level_init(level_path);
+        scene_init();
+
+        // the last frames are cut short so that every run stops on exactly the same tick
+        unsigned int frames = 0;
+        while (scene_ticks < ticks && !replay_finished()) {
+            scene_advance(std::min(frame_times[frames % frame_times.size()], (ticks - scene_ticks) * tick_time));
+            frames++;
+        }
+
+        unsigned int checksum = scene_checksum();
+        if (i == 0) {
+            first_checksum = checksum;
+        }
+        rates_match = rates_match && checksum == first_checksum && scene_ticks == ticks;
+        printf("  %u ticks in %u frames of %s%.2f ms, state checksum %08x\n",
+               scene_ticks, frames, frame_times.size() > 1 ? "uneven, mean " : "",
+               std::accumulate(frame_times.begin(), frame_times.end(), 0.0f) / frame_times.size(), checksum);
+    }
+
+    printf(rates_match ? "Render rates give the same simulation\n" : "Render rates give different simulations!\n");
+    return rates_match;
+}
+
+// FNV-1a over the raw bits of the player and enemy state, two runs only match if they agree bit for bit
+void scene_checksum_bytes(unsigned int* hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        *hash = (*hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+unsigned int scene_checksum() {
+    unsigned int hash = 2166136261u;
+    scene_checksum_bytes(&hash, &player.position, sizeof(player.position));
+    scene_checksum_bytes(&hash, &player.velocity, sizeof(player.velocity));
+    scene_checksum_bytes(&hash, &player.basis, sizeof(player.basis));
+    scene_checksum_bytes(&hash, &player.recoil, sizeof(player.recoil));
+    scene_checksum_bytes(&hash, &player.health, sizeof(player.health));
+    scene_checksum_bytes(&hash, &player.clip_ammo, sizeof(player.clip_ammo));
+    scene_checksum_bytes(&hash, &player.reserve_ammo, sizeof(player.reserve_ammo));
+    for (const Enemy& enemy : enemies) {
+        scene_checksum_bytes(&hash, &enemy.position, sizeof(enemy.position));
+        scene_checksum_bytes(&hash, &enemy.direction, sizeof(enemy.direction));
+        scene_checksum_bytes(&hash, &enemy.health, sizeof(enemy.health));
+        scene_checksum_bytes(&hash, &enemy.is_dead, sizeof(enemy.is_dead));
+    }
+    for (const Sector& sector : sectors) {
+        unsigned int bullet_holes = sector.bullet_holes.size();
+        scene_checksum_bytes(&hash, &bullet_holes, sizeof(bullet_holes));
+    }
+    return hash;
 }
 
 void scene_update(float delta) {
+    ProfileScope profile_scope("scene_update");
     // update player
     player.update(delta);
     scene_move_and_slide(&player.position, &player.velocity, delta);
@@ -42,7 +208,11 @@ void scene_update(float delta) {
     if (player.raycast_result.hit) {
         const RaycastPlane& plane = raycast_planes[player.raycast_result.plane];
         if (plane.type == PLANE_TYPE_LEVEL) {
-            sectors[plane.id].bullet_holes.push_back({
+            std::vector<LevelBulletHole>& bullet_holes = sectors[plane.id].bullet_holes;
+            if (bullet_holes.size() == LEVEL_MAX_BULLET_HOLES) {
+                bullet_holes.erase(bullet_holes.begin());
+            }
+            bullet_holes.push_back({
                 .position = player.raycast_result.point + (plane.normal * 0.05f),
                 .normal = plane.normal
             });
@@ -62,6 +232,7 @@ void scene_update(float delta) {
 }
 
 void scene_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta) {
+    ProfileScope profile_scope("scene_move_and_slide");
     // check collisions and move player
     if (glm::length(*velocity) == 0.0f) {
         return;
@@ -69,7 +240,7 @@ void scene_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta)
     glm::vec3 actual_velocity = *velocity * delta;
 
     // check if within sector AABB
-    std::vector<Sector*> nearby_sectors;
+    FrameVector<Sector*> nearby_sectors;
     for (unsigned int i = 0; i < sectors.size(); i++) {
         Sector* sector = &sectors[i];
         float padding = 1.0f;
@@ -84,17 +255,7 @@ void scene_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta)
     // check floor / ceiling collisions
     glm::vec2 origin2d = glm::vec2(position->x, position->z);
     for (Sector* sector : nearby_sectors) {
-        glm::vec2 raycast_start = sector->aabb_top_left - glm::vec2(1.0f, 1.0f);
-        glm::vec2 raycast_direction = origin2d - raycast_start;
-        unsigned int hits = 0;
-        for (unsigned int wall = 0; wall < sector->vertices.size(); wall++) {
-            float raycast_result = raycast_cast2d(raycast_start, raycast_direction, sector->vertices[wall], sector->vertices[(wall + 1) % sector->vertices.size()] - sector->vertices[wall]);
-            if (raycast_result != -1.0f) {
-                hits++;
-            }
-        }
-
-        if (hits % 2 == 0) {
+        if (!sector->contains(origin2d)) {
             continue;
         }
 
@@ -116,10 +277,11 @@ void scene_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta)
     while (collided && attempts < 10) {
         collided = false;
         attempts++;
+        stats_add(STAT_COLLISION_ITERATIONS, 1);
 
-        std::vector<glm::vec2> wall_a;
-        std::vector<glm::vec2> wall_b;
-        std::vector<glm::vec3> wall_normal;
+        FrameVector<glm::vec2> wall_a;
+        FrameVector<glm::vec2> wall_b;
+        FrameVector<glm::vec3> wall_normal;
         for (Sector* sector : nearby_sectors) {
             for (unsigned int wall = 0; wall < sector->vertices.size(); wall++) {
                 if (!sector->walls[wall].exists) {
@@ -181,31 +343,60 @@ void scene_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta)
     *position += actual_velocity;
 }
 
-void scene_render() {
-    glm::vec3 camera_direction = player.position + player.direction;
+void scene_capture(FrameSnapshot* frame, float interpolation) {
+    ProfileScope profile_scope("scene_capture");
+    // the simulation runs at its own rate, so the camera is placed between the last two ticks
+    glm::vec3 view_position = glm::mix(player.previous_position, player.position, interpolation);
+    glm::vec3 view_direction = glm::mix(player.previous_direction, player.direction, interpolation);
+    glm::vec3 flashlight_direction = glm::mix(player.previous_flashlight_direction, player.flashlight_direction, interpolation);
+    glm::mat4 view_basis = glm::mat4_cast(glm::slerp(glm::quat_cast(player.previous_basis), glm::quat_cast(player.basis), interpolation));
+
+    glm::vec3 camera_direction = view_position + view_direction;
     glm::mat4 view;
-    view = glm::lookAt(player.position, camera_direction, glm::vec3(player.basis[1]));
+    view = glm::lookAt(view_position, camera_direction, glm::vec3(view_basis[1]));
     glm::mat4 projection;
     projection = glm::perspective(glm::radians(45.0f), static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT), 0.1f, 100.0f);
 
+    frame->view = view;
+    frame->projection = projection;
+    frame->view_position = view_position;
+    frame->flashlight_direction = flashlight_direction;
+    frame->flashlight_on = player.flashlight_on;
+
+    // enemies are culled against the sectors level_cull found visible
+    level_cull(view, projection, view_position, &frame->visible_sectors, &frame->decals);
+    frame->billboards.clear();
+    for (Enemy& enemy : enemies) {
+        enemy.capture(interpolation, &frame->billboards);
+    }
+
+    frame->hud = player.capture_hud();
+    frame->elapsed = elapsed;
+    frame->screen_anim_timer = screen_anim_timer;
+    frame->cull_stats = cull_stats;
+}
+
+void scene_render(const FrameSnapshot& frame) {
+    ProfileScope profile_scope("scene_render");
     // prepare billboard shader
     glUseProgram(billboard_shader);
-    glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniform1ui(glGetUniformLocation(billboard_shader, "flashlight_on"), player.flashlight_on);
-    glUniform3fv(glGetUniformLocation(billboard_shader, "view_pos"), 1, glm::value_ptr(player.position));
-    glUniform3fv(glGetUniformLocation(billboard_shader, "player_flashlight.position"), 1, glm::value_ptr(player.position));
-    glUniform3fv(glGetUniformLocation(billboard_shader, "player_flashlight.direction"), 1, glm::value_ptr(player.flashlight_direction));
-    glUniform1ui(glGetUniformLocation(billboard_shader, "frame"), 0);
+    glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "projection"), 1, GL_FALSE, glm::value_ptr(frame.projection));
+    glUniformMatrix4fv(glGetUniformLocation(billboard_shader, "view"), 1, GL_FALSE, glm::value_ptr(frame.view));
+    glUniform1ui(glGetUniformLocation(billboard_shader, "flashlight_on"), frame.flashlight_on);
+    glUniform3fv(glGetUniformLocation(billboard_shader, "view_pos"), 1, glm::value_ptr(frame.view_position));
+    glUniform3fv(glGetUniformLocation(billboard_shader, "player_flashlight.position"), 1, glm::value_ptr(frame.view_position));
+    glUniform3fv(glGetUniformLocation(billboard_shader, "player_flashlight.direction"), 1, glm::value_ptr(frame.flashlight_direction));
     glUniform1ui(glGetUniformLocation(billboard_shader, "flip_h"), false);
 
-    level_render(view, projection, player.position, player.flashlight_direction, player.flashlight_on);
+    level_draw(frame.view, frame.projection, frame.view_position, frame.flashlight_direction, frame.flashlight_on, frame.visible_sectors, frame.decals);
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_DEPTH_TEST);
-    for (Enemy& enemy : enemies) {
-        enemy.render();
-    }
+    billboard_draw(frame.billboards);
+
+    player_render_hud(frame.hud);
 
-    player.render();
+    // the screen pass reads the player's health for its noise
+    glUseProgram(screen_shader);
+    glUniform1ui(glGetUniformLocation(screen_shader, "player_health"), frame.hud.health);
 }
@@ -1,8 +1,31 @@
 #pragma once
 
+#include "frame.hpp"
+#include "resource.hpp"
+
 #include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+extern Player player;
 
+// the simulation and the GL state for drawing it are set up separately, so the simulation can run headless
 void scene_init();
+void scene_init_render();
+// the textures a game on the loaded level uses, the enemy sprites are left out of levels without enemies
+void scene_resources(std::vector<ResourceHandle>* handles);
+// runs as many fixed ticks as fit in the time since the last frame, and returns
+// how far between the last two ticks the frame is, for interpolating what gets rendered
+float scene_advance(float frame_time);
 void scene_update(float delta);
 void scene_move_and_slide(glm::vec3* position, glm::vec3* velocity, float delta);
-void scene_render();
+// records what the renderer needs from the simulation, the player and enemies are placed between the last two ticks
+void scene_capture(FrameSnapshot* frame, float interpolation);
+void scene_render(const FrameSnapshot& frame);
+// ticks the simulation as fast as it goes and reports how fast that was
+void scene_run_headless(unsigned int ticks);
+// runs the same ticks with the same input at several frame rates, even and uneven, starting over from the level each time,
+// and returns whether every run ends on the same checksum
+bool scene_check_render_rates(const std::string& level_path, unsigned int seed, unsigned int ticks);
+// a hash of the simulation state, for checking that replays come out the same
+unsigned int scene_checksum();
@@ -1,11 +1,12 @@
 #include "shader.hpp"
 
+#include "pack.hpp"
+
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
 #include <cstdio>
-#include <sstream>
+#include <vector>
 
 unsigned int text_shader;
 unsigned int texture_shader;
@@ -13,59 +14,64 @@ unsigned int billboard_shader;
 unsigned int screen_shader;
 unsigned int ui_shader;
 
-bool shader_compile(unsigned int* id, const char* vertex_path, const char* fragment_path);
-
-bool shader_compile_all() {
-    if (!shader_compile(&text_shader, "./shader/text_vertex.glsl", "./shader/text_fragment.glsl")) {
-        return false;
-    }
-    if (!shader_compile(&texture_shader, "./shader/texture_vertex.glsl", "./shader/texture_fragment.glsl")) {
-        return false;
-    }
-    if (!shader_compile(&billboard_shader, "./shader/billboard_vertex.glsl", "./shader/billboard_fragment.glsl")) {
-        return false;
-    }
-    if (!shader_compile(&screen_shader, "./shader/screen_vertex.glsl", "./shader/screen_fragment.glsl")) {
-        return false;
-    }
-    if (!shader_compile(&ui_shader, "./shader/ui_vertex.glsl", "./shader/ui_fragment.glsl")) {
-        return false;
+struct ShaderSource {
+    unsigned int* id;
+    const char* vertex_path;
+    const char* fragment_path;
+    std::string vertex_code;
+    std::string fragment_code;
+};
+
+ShaderSource shader_sources[] = {
+    { .id = &text_shader, .vertex_path = "./shader/text_vertex.glsl", .fragment_path = "./shader/text_fragment.glsl" },
+    { .id = &texture_shader, .vertex_path = "./shader/texture_vertex.glsl", .fragment_path = "./shader/texture_fragment.glsl" },
+    { .id = &billboard_shader, .vertex_path = "./shader/billboard_vertex.glsl", .fragment_path = "./shader/billboard_fragment.glsl" },
+    { .id = &screen_shader, .vertex_path = "./shader/screen_vertex.glsl", .fragment_path = "./shader/screen_fragment.glsl" },
+    { .id = &ui_shader, .vertex_path = "./shader/ui_vertex.glsl", .fragment_path = "./shader/ui_fragment.glsl" }
+};
+const unsigned int NUM_SHADERS = sizeof(shader_sources) / sizeof(ShaderSource);
+
+bool shader_read(ShaderSource* source);
+bool shader_compile(const ShaderSource& source);
+
+bool shader_read_all() {
+    for (unsigned int i = 0; i < NUM_SHADERS; i++) {
+        if (!shader_read(&shader_sources[i])) {
+            return false;
+        }
     }
 
     return true;
 }
 
-bool shader_compile(unsigned int* id, const char* vertex_path, const char* fragment_path) {
-    std::string vertex_code;
-    std::string fragment_code;
-    std::ifstream vertex_shader_file;
-    std::ifstream fragment_shader_file;
-
-    // ensure ifstream objects can throw exceptions
-    vertex_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragment_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try {
-        vertex_shader_file.open(vertex_path);
-        fragment_shader_file.open(fragment_path);
-        std::stringstream vertex_shader_stream;
-        std::stringstream fragment_shader_stream;
-
-        vertex_shader_stream << vertex_shader_file.rdbuf();
-        fragment_shader_stream << fragment_shader_file.rdbuf();
+bool shader_compile_all() {
+    for (unsigned int i = 0; i < NUM_SHADERS; i++) {
+        if (!shader_compile(shader_sources[i])) {
+            return false;
+        }
+    }
 
-        vertex_shader_file.close();
-        fragment_shader_file.close();
+    return true;
+}
 
-        vertex_code = vertex_shader_stream.str();
-        fragment_code = fragment_shader_stream.str();
-    } catch (std::exception& e) {
-        printf("Error: shader file (%s, %s) not successfully read\n", vertex_path, fragment_path);
+bool shader_read(ShaderSource* source) {
+    std::vector<unsigned char> vertex_code;
+    std::vector<unsigned char> fragment_code;
+    if (!pack_read(source->vertex_path, &vertex_code) || !pack_read(source->fragment_path, &fragment_code)) {
+        printf("Error: shader file (%s, %s) not successfully read\n", source->vertex_path, source->fragment_path);
         return false;
     }
 
-    const char* vertex_shader_code = vertex_code.c_str();
-    const char* fragment_shader_code = fragment_code.c_str();
+    source->vertex_code.assign(vertex_code.begin(), vertex_code.end());
+    source->fragment_code.assign(fragment_code.begin(), fragment_code.end());
+    return true;
+}
+
+bool shader_compile(const ShaderSource& source) {
+    const char* vertex_path = source.vertex_path;
+    const char* fragment_path = source.fragment_path;
+    const char* vertex_shader_code = source.vertex_code.c_str();
+    const char* fragment_shader_code = source.fragment_code.c_str();
 
     unsigned int vertex;
     unsigned int fragment;
@@ -106,6 +112,6 @@ bool shader_compile(unsigned int* id, const char* vertex_path, const char* fragm
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 
-    *id = program;
+    *source.id = program;
     return true;
 }
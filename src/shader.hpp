@@ -10,4 +10,6 @@ extern unsigned int billboard_shader;
 extern unsigned int screen_shader;
 extern unsigned int ui_shader;
 
+// reading only touches files, compiling needs the GL context and the sources read first
+bool shader_read_all();
 bool shader_compile_all();
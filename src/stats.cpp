@@ -0,0 +1,379 @@
+#include "stats.hpp"
+
+#include "font.hpp"
+#include "globals.hpp"
+#include "profile.hpp"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+struct StatSummary {
+    float average;
+    unsigned int p50;
+    unsigned int p95;
+    unsigned int p99;
+    unsigned int max;
+};
+
+const char* STAT_NAMES[STAT_COUNT] = {
+    "draw_calls",
+    "triangles",
+    "program_binds",
+    "texture_binds",
+    "vao_binds",
+    "uniform_uploads",
+    "raycasts",
+    "raycast_planes",
+    "sectors_visible",
+    "sectors_culled",
+    "enemies_updated",
+    "collision_iters",
+    "allocations"
+};
+
+const unsigned int STATS_HISTORY_SIZE = 1024;
+// about two seconds at 60 fps
+const unsigned int STATS_OVERLAY_FRAMES = 120;
+
+std::atomic<unsigned int> stats_counters[STAT_COUNT];
+
+unsigned int stats_history[STATS_HISTORY_SIZE][STAT_COUNT];
+unsigned long stats_frame = 0;
+float stats_time = 0.0f;
+// fixed size so that summarizing doesn't show up in the allocation count
+unsigned int stats_scratch[STATS_HISTORY_SIZE];
+
+FILE* stats_log_file = NULL;
+bool stats_log_json = false;
+float stats_log_interval = 1.0f;
+float stats_log_timer = 0.0f;
+unsigned long stats_log_frame = 0;
+
+// where allocations after the warm-up came from, kept in a fixed table since recording one can't allocate
+struct StatsAllocationSite {
+    const char* scope;
+    unsigned long count;
+    unsigned long first_frame;
+};
+
+const unsigned int STATS_MAX_ALLOCATION_SITES = 64;
+
+bool stats_tracking_allocations = false;
+unsigned long stats_warmup_frames = 0;
+std::atomic<bool> stats_after_warmup(false);
+std::mutex stats_allocation_mutex;
+StatsAllocationSite stats_allocation_sites[STATS_MAX_ALLOCATION_SITES];
+unsigned int stats_allocation_site_count = 0;
+unsigned long stats_allocating_frames = 0;
+
+PFNGLDRAWARRAYSPROC stats_gl_draw_arrays;
+PFNGLUSEPROGRAMPROC stats_gl_use_program;
+PFNGLBINDTEXTUREPROC stats_gl_bind_texture;
+PFNGLBINDVERTEXARRAYPROC stats_gl_bind_vertex_array;
+PFNGLUNIFORM1IPROC stats_gl_uniform_1i;
+PFNGLUNIFORM1UIPROC stats_gl_uniform_1ui;
+PFNGLUNIFORM1FPROC stats_gl_uniform_1f;
+PFNGLUNIFORM2IVPROC stats_gl_uniform_2iv;
+PFNGLUNIFORM3FVPROC stats_gl_uniform_3fv;
+PFNGLUNIFORM4FVPROC stats_gl_uniform_4fv;
+PFNGLUNIFORMMATRIX4FVPROC stats_gl_uniform_matrix_4fv;
+
+void stats_record_allocation() {
+    const char* scope = profile_current_scope();
+    if (scope == nullptr) {
+        scope = "outside any scope";
+    }
+
+    std::lock_guard<std::mutex> lock(stats_allocation_mutex);
+    for (unsigned int i = 0; i < stats_allocation_site_count; i++) {
+        if (strcmp(stats_allocation_sites[i].scope, scope) == 0) {
+            stats_allocation_sites[i].count++;
+            return;
+        }
+    }
+    if (stats_allocation_site_count < STATS_MAX_ALLOCATION_SITES) {
+        stats_allocation_sites[stats_allocation_site_count] = {
+            .scope = scope,
+            .count = 1,
+            .first_frame = stats_frame
+        };
+        stats_allocation_site_count++;
+    }
+}
+
+void* operator new(std::size_t size) {
+    stats_add(STAT_ALLOCATIONS, 1);
+    if (stats_after_warmup.load(std::memory_order_relaxed)) {
+        stats_record_allocation();
+    }
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == NULL) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void APIENTRY stats_draw_arrays(GLenum mode, GLint first, GLsizei count) {
+    stats_add(STAT_DRAW_CALLS, 1);
+    if (mode == GL_TRIANGLES) {
+        stats_add(STAT_TRIANGLES, count / 3);
+    }
+    stats_gl_draw_arrays(mode, first, count);
+}
+
+void APIENTRY stats_use_program(GLuint program) {
+    stats_add(STAT_PROGRAM_BINDS, 1);
+    stats_gl_use_program(program);
+}
+
+void APIENTRY stats_bind_texture(GLenum target, GLuint texture) {
+    stats_add(STAT_TEXTURE_BINDS, 1);
+    stats_gl_bind_texture(target, texture);
+}
+
+void APIENTRY stats_bind_vertex_array(GLuint array) {
+    stats_add(STAT_VAO_BINDS, 1);
+    stats_gl_bind_vertex_array(array);
+}
+
+void APIENTRY stats_uniform_1i(GLint location, GLint v0) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_1i(location, v0);
+}
+
+void APIENTRY stats_uniform_1ui(GLint location, GLuint v0) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_1ui(location, v0);
+}
+
+void APIENTRY stats_uniform_1f(GLint location, GLfloat v0) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_1f(location, v0);
+}
+
+void APIENTRY stats_uniform_2iv(GLint location, GLsizei count, const GLint* value) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_2iv(location, count, value);
+}
+
+void APIENTRY stats_uniform_3fv(GLint location, GLsizei count, const GLfloat* value) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_3fv(location, count, value);
+}
+
+void APIENTRY stats_uniform_4fv(GLint location, GLsizei count, const GLfloat* value) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_4fv(location, count, value);
+}
+
+void APIENTRY stats_uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    stats_add(STAT_UNIFORM_UPLOADS, 1);
+    stats_gl_uniform_matrix_4fv(location, count, transpose, value);
+}
+
+void stats_hook_gl() {
+    stats_gl_draw_arrays = glad_glDrawArrays;
+    glad_glDrawArrays = stats_draw_arrays;
+    stats_gl_use_program = glad_glUseProgram;
+    glad_glUseProgram = stats_use_program;
+    stats_gl_bind_texture = glad_glBindTexture;
+    glad_glBindTexture = stats_bind_texture;
+    stats_gl_bind_vertex_array = glad_glBindVertexArray;
+    glad_glBindVertexArray = stats_bind_vertex_array;
+    stats_gl_uniform_1i = glad_glUniform1i;
+    glad_glUniform1i = stats_uniform_1i;
+    stats_gl_uniform_1ui = glad_glUniform1ui;
+    glad_glUniform1ui = stats_uniform_1ui;
+    stats_gl_uniform_1f = glad_glUniform1f;
+    glad_glUniform1f = stats_uniform_1f;
+    stats_gl_uniform_2iv = glad_glUniform2iv;
+    glad_glUniform2iv = stats_uniform_2iv;
+    stats_gl_uniform_3fv = glad_glUniform3fv;
+    glad_glUniform3fv = stats_uniform_3fv;
+    stats_gl_uniform_4fv = glad_glUniform4fv;
+    glad_glUniform4fv = stats_uniform_4fv;
+    stats_gl_uniform_matrix_4fv = glad_glUniformMatrix4fv;
+    glad_glUniformMatrix4fv = stats_uniform_matrix_4fv;
+}
+
+// summarizes the last frame_count frames
+StatSummary stats_summarize(Stat stat, unsigned long frame_count) {
+    frame_count = std::min(frame_count, std::min(stats_frame, (unsigned long)STATS_HISTORY_SIZE));
+    if (frame_count == 0) {
+        return { .average = 0.0f, .p50 = 0, .p95 = 0, .p99 = 0, .max = 0 };
+    }
+
+    unsigned long sum = 0;
+    for (unsigned long i = 0; i < frame_count; i++) {
+        stats_scratch[i] = stats_history[(stats_frame - 1 - i) % STATS_HISTORY_SIZE][stat];
+        sum += stats_scratch[i];
+    }
+
+    StatSummary summary;
+    summary.average = (float)sum / frame_count;
+    unsigned int percentiles[] = { 50, 95, 99, 100 };
+    unsigned int* results[] = { &summary.p50, &summary.p95, &summary.p99, &summary.max };
+    for (unsigned int i = 0; i < 4; i++) {
+        unsigned long rank = stats_percentile_rank(frame_count, percentiles[i]);
+        std::nth_element(stats_scratch, stats_scratch + rank, stats_scratch + frame_count);
+        *results[i] = stats_scratch[rank];
+    }
+
+    return summary;
+}
+
+float stats_planes_per_raycast(unsigned long frame_count) {
+    StatSummary raycasts = stats_summarize(STAT_RAYCASTS, frame_count);
+    StatSummary planes = stats_summarize(STAT_RAYCAST_PLANES, frame_count);
+    return raycasts.average == 0.0f ? 0.0f : planes.average / raycasts.average;
+}
+
+bool stats_init(const std::string& log_path, float log_interval) {
+    stats_log_interval = log_interval;
+    if (log_path == "") {
+        return true;
+    }
+
+    stats_log_file = fopen(log_path.c_str(), "w");
+    if (stats_log_file == NULL) {
+        printf("Unable to open stats log %s\n", log_path.c_str());
+        return false;
+    }
+    stats_log_json = log_path.length() >= 5 && log_path.substr(log_path.length() - 5) == ".json";
+
+    if (stats_log_json) {
+        fprintf(stats_log_file, "[\n");
+    } else {
+        fprintf(stats_log_file, "frame,time,frames");
+        for (unsigned int stat = 0; stat < STAT_COUNT; stat++) {
+            const char* name = STAT_NAMES[stat];
+            fprintf(stats_log_file, ",%s_avg,%s_p50,%s_p95,%s_p99,%s_max", name, name, name, name, name);
+        }
+        fprintf(stats_log_file, ",planes_per_raycast\n");
+    }
+
+    return true;
+}
+
+void stats_write_log_row() {
+    // each row covers the frames since the last one
+    unsigned long frame_count = stats_frame - stats_log_frame;
+    if (stats_log_json) {
+        fprintf(stats_log_file, "%s  {\"frame\": %lu, \"time\": %.3f, \"frames\": %lu", stats_log_frame == 0 ? "" : ",\n", stats_frame, stats_time / 1000.0f, frame_count);
+    } else {
+        fprintf(stats_log_file, "%lu,%.3f,%lu", stats_frame, stats_time / 1000.0f, frame_count);
+    }
+
+    for (unsigned int stat = 0; stat < STAT_COUNT; stat++) {
+        StatSummary summary = stats_summarize((Stat)stat, frame_count);
+        if (stats_log_json) {
+            fprintf(stats_log_file, ", \"%s\": {\"avg\": %.2f, \"p50\": %u, \"p95\": %u, \"p99\": %u, \"max\": %u}",
+                    STAT_NAMES[stat], summary.average, summary.p50, summary.p95, summary.p99, summary.max);
+        } else {
+            fprintf(stats_log_file, ",%.2f,%u,%u,%u,%u", summary.average, summary.p50, summary.p95, summary.p99, summary.max);
+        }
+    }
+
+    if (stats_log_json) {
+        fprintf(stats_log_file, ", \"planes_per_raycast\": %.2f}", stats_planes_per_raycast(frame_count));
+    } else {
+        fprintf(stats_log_file, ",%.2f\n", stats_planes_per_raycast(frame_count));
+    }
+    stats_log_frame = stats_frame;
+}
+
+void stats_quit() {
+    if (stats_log_file == NULL) {
+        return;
+    }
+
+    if (stats_frame > stats_log_frame) {
+        stats_write_log_row();
+    }
+    if (stats_log_json) {
+        fprintf(stats_log_file, "\n]\n");
+    }
+    fclose(stats_log_file);
+    stats_log_file = NULL;
+}
+
+void stats_frame_end(float frame_time) {
+    unsigned int* frame = stats_history[stats_frame % STATS_HISTORY_SIZE];
+    for (unsigned int stat = 0; stat < STAT_COUNT; stat++) {
+        frame[stat] = stats_counters[stat].exchange(0, std::memory_order_relaxed);
+    }
+    if (stats_tracking_allocations && stats_frame >= stats_warmup_frames && frame[STAT_ALLOCATIONS] > 0) {
+        stats_allocating_frames++;
+    }
+    stats_frame++;
+    stats_time += frame_time;
+    if (stats_tracking_allocations) {
+        stats_after_warmup.store(stats_frame >= stats_warmup_frames, std::memory_order_relaxed);
+    }
+
+    if (stats_log_file == NULL) {
+        return;
+    }
+    stats_log_timer += frame_time;
+    // rows can't cover more frames than the history holds
+    if (stats_log_timer >= stats_log_interval * 1000.0f || stats_frame - stats_log_frame >= STATS_HISTORY_SIZE) {
+        stats_log_timer = 0.0f;
+        stats_write_log_row();
+    }
+}
+
+void stats_track_allocations(unsigned int warmup_frames) {
+    stats_tracking_allocations = true;
+    stats_warmup_frames = stats_frame + warmup_frames;
+}
+
+bool stats_allocation_report() {
+    stats_after_warmup.store(false, std::memory_order_relaxed);
+    unsigned long frames = stats_frame > stats_warmup_frames ? stats_frame - stats_warmup_frames : 0;
+    if (frames == 0) {
+        printf("Allocation test didn't get past the %lu frame warm-up\n", stats_warmup_frames);
+        return false;
+    }
+    if (stats_allocating_frames == 0 && stats_allocation_site_count == 0) {
+        printf("Allocation test passed, none of the %lu frames after the warm-up allocated\n", frames);
+        return true;
+    }
+
+    printf("Allocation test failed, %lu of the %lu frames after the warm-up allocated\n", stats_allocating_frames, frames);
+    for (unsigned int i = 0; i < stats_allocation_site_count; i++) {
+        const StatsAllocationSite& site = stats_allocation_sites[i];
+        printf("  %-28s %6lu allocations, first in frame %lu\n", site.scope, site.count, site.first_frame);
+    }
+    return false;
+}
+
+unsigned int stats_last_frame(Stat stat) {
+    if (stats_frame == 0) {
+        return 0;
+    }
+    return stats_history[(stats_frame - 1) % STATS_HISTORY_SIZE][stat];
+}
+
+void stats_render_overlay(float y) {
+    char line[64];
+    snprintf(line, sizeof(line), "%-15s%6s%6s%6s", "STAT", "AVG", "P95", "MAX");
+    font_hack_10pt.render_text(line, SCREEN_WIDTH - (strlen(line) * 10.0f), y, glm::vec3(1.0f, 1.0f, 0.0f));
+    for (unsigned int stat = 0; stat < STAT_COUNT; stat++) {
+        y += 10.0f;
+        StatSummary summary = stats_summarize((Stat)stat, STATS_OVERLAY_FRAMES);
+        snprintf(line, sizeof(line), "%-15s%6.0f%6u%6u", STAT_NAMES[stat], summary.average, summary.p95, summary.max);
+        font_hack_10pt.render_text(line, SCREEN_WIDTH - (strlen(line) * 10.0f), y, glm::vec3(1.0f, 1.0f, 1.0f));
+    }
+    y += 10.0f;
+    snprintf(line, sizeof(line), "%-15s%6.1f", "planes/raycast", stats_planes_per_raycast(STATS_OVERLAY_FRAMES));
+    font_hack_10pt.render_text(line, SCREEN_WIDTH - (strlen(line) * 10.0f), y, glm::vec3(1.0f, 1.0f, 1.0f));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// engine counters for capacity planning, kept per frame with a history for averages and percentiles
+// GL calls are counted by wrapping glad's function pointers and heap allocations by replacing operator new,
+// so neither needs anything at the call sites
+
+enum Stat {
+    STAT_DRAW_CALLS,
+    STAT_TRIANGLES,
+    STAT_PROGRAM_BINDS,
+    STAT_TEXTURE_BINDS,
+    STAT_VAO_BINDS,
+    STAT_UNIFORM_UPLOADS,
+    STAT_RAYCASTS,
+    STAT_RAYCAST_PLANES,
+    STAT_SECTORS_VISIBLE,
+    STAT_SECTORS_CULLED,
+    STAT_ENEMIES_UPDATED,
+    STAT_COLLISION_ITERATIONS,
+    STAT_ALLOCATIONS,
+    STAT_COUNT
+};
+
+// the simulation thread counts too, so the counters are atomic
+extern std::atomic<unsigned int> stats_counters[STAT_COUNT];
+
+inline void stats_add(Stat stat, unsigned int amount) {
+    stats_counters[stat].fetch_add(amount, std::memory_order_relaxed);
+}
+
+// the log is JSON when the path ends in .json and CSV otherwise, an empty path doesn't log
+bool stats_init(const std::string& log_path, float log_interval);
+void stats_quit();
+// after gladLoadGLLoader
+void stats_hook_gl();
+// once per frame on the main thread, or once per tick when headless
+void stats_frame_end(float frame_time);
+// the count for the frame stats_frame_end last finished
+unsigned int stats_last_frame(Stat stat);
+// index of the given percentile in count sorted values, nearest rank so that 100 is the last one
+inline unsigned long stats_percentile_rank(unsigned long count, unsigned int percentile) {
+    unsigned long rank = (count * percentile) / 100;
+    return rank < count - 1 ? rank : count - 1;
+}
+
+// once warmup_frames have passed, every allocation is put down to the profile scope it happened in,
+// needs profile_track_scopes on to know the scopes
+void stats_track_allocations(unsigned int warmup_frames);
+// prints where the allocations after the warm-up happened, returns false if there were any
+bool stats_allocation_report();
+void stats_render_overlay(float y);
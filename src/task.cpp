@@ -0,0 +1,197 @@
+#include "task.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct Task {
+    std::string name;
+    std::function<void()> function;
+    std::vector<unsigned int> dependencies;
+    bool done;
+};
+
+struct TaskTrace {
+    std::string name;
+    // 0 is the main thread, workers start at 1
+    unsigned int thread;
+    float start;
+    float end;
+};
+
+// a deque so that references to tasks stay valid while new ones are submitted
+std::deque<Task> tasks;
+std::vector<unsigned int> pending_tasks;
+std::vector<std::thread> task_threads;
+std::mutex task_mutex;
+std::condition_variable task_ready_condition;
+std::condition_variable task_done_condition;
+bool task_running = false;
+unsigned int task_worker_count = 0;
+
+std::vector<TaskTrace> task_traces;
+std::chrono::steady_clock::time_point task_start_time = std::chrono::steady_clock::now();
+
+float task_time() {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - task_start_time).count();
+}
+
+void task_worker(unsigned int thread) {
+    std::unique_lock<std::mutex> lock(task_mutex);
+    while (true) {
+        int ready_task = -1;
+        for (unsigned int i = 0; i < pending_tasks.size() && ready_task == -1; i++) {
+            bool is_ready = true;
+            for (unsigned int dependency : tasks[pending_tasks[i]].dependencies) {
+                is_ready = is_ready && tasks[dependency].done;
+            }
+            if (is_ready) {
+                ready_task = pending_tasks[i];
+                pending_tasks.erase(pending_tasks.begin() + i);
+            }
+        }
+
+        if (ready_task == -1) {
+            if (!task_running) {
+                return;
+            }
+            task_ready_condition.wait(lock);
+            continue;
+        }
+
+        std::function<void()> function;
+        function.swap(tasks[ready_task].function);
+        lock.unlock();
+        float start = task_time();
+        function();
+        float end = task_time();
+        lock.lock();
+
+        tasks[ready_task].done = true;
+        task_traces.push_back({
+            .name = tasks[ready_task].name,
+            .thread = thread,
+            .start = start,
+            .end = end
+        });
+        // finishing a task can make the tasks depending on it ready
+        task_done_condition.notify_all();
+        task_ready_condition.notify_all();
+    }
+}
+
+void task_init(unsigned int thread_count) {
+    task_running = true;
+    task_worker_count = thread_count <= 1 ? 0 : thread_count;
+    if (thread_count <= 1) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < thread_count; i++) {
+        task_threads.push_back(std::thread(task_worker, i + 1));
+    }
+}
+
+void task_quit() {
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        task_running = false;
+    }
+    task_ready_condition.notify_all();
+    for (std::thread& thread : task_threads) {
+        thread.join();
+    }
+    task_threads.clear();
+}
+
+unsigned int task_submit(const std::string& name, std::function<void()> function, const std::vector<unsigned int>& dependencies) {
+    if (task_threads.empty()) {
+        // dependencies were submitted earlier, so they've already run
+        unsigned int index = tasks.size();
+        tasks.push_back({
+            .name = name,
+            .function = nullptr,
+            .dependencies = dependencies,
+            .done = false
+        });
+        task_run_here(name, function);
+        tasks[index].done = true;
+        return index;
+    }
+
+    unsigned int index;
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        index = tasks.size();
+        tasks.push_back({
+            .name = name,
+            .function = function,
+            .dependencies = dependencies,
+            .done = false
+        });
+        pending_tasks.push_back(index);
+    }
+    task_ready_condition.notify_all();
+
+    return index;
+}
+
+void task_wait(unsigned int task) {
+    std::unique_lock<std::mutex> lock(task_mutex);
+    task_done_condition.wait(lock, [task]() {
+        return tasks[task].done;
+    });
+}
+
+unsigned int task_wait_any(std::vector<unsigned int>* task_list) {
+    std::unique_lock<std::mutex> lock(task_mutex);
+    while (true) {
+        for (unsigned int i = 0; i < task_list->size(); i++) {
+            unsigned int task = (*task_list)[i];
+            if (tasks[task].done) {
+                task_list->erase(task_list->begin() + i);
+                return task;
+            }
+        }
+        task_done_condition.wait(lock);
+    }
+}
+
+void task_run_here(const std::string& name, std::function<void()> function) {
+    float start = task_time();
+    function();
+    float end = task_time();
+
+    std::lock_guard<std::mutex> lock(task_mutex);
+    task_traces.push_back({
+        .name = name,
+        .thread = 0,
+        .start = start,
+        .end = end
+    });
+}
+
+void task_trace_print() {
+    std::vector<TaskTrace> traces;
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        traces = task_traces;
+    }
+    std::stable_sort(traces.begin(), traces.end(), [](const TaskTrace& a, const TaskTrace& b) {
+        return a.start < b.start;
+    });
+
+    float first_start = traces.empty() ? 0.0f : traces[0].start;
+    float last_end = first_start;
+    printf("Startup trace with %u worker threads, times in ms\n", task_worker_count);
+    printf("  thread     start       end  task\n");
+    for (const TaskTrace& trace : traces) {
+        printf("  %6u  %8.2f  %8.2f  %s\n", trace.thread, trace.start - first_start, trace.end - first_start, trace.name.c_str());
+        last_end = std::max(last_end, trace.end);
+    }
+    printf("Startup took %.2f ms\n", last_end - first_start);
+}
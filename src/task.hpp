@@ -0,0 +1,21 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// a small thread pool for CPU-only work, tasks must never make GL calls
+// with a thread count of 1 or less there are no workers and tasks run inline when submitted
+
+void task_init(unsigned int thread_count);
+void task_quit();
+
+// a task only starts once all of its dependencies have finished
+unsigned int task_submit(const std::string& name, std::function<void()> function, const std::vector<unsigned int>& dependencies = std::vector<unsigned int>());
+void task_wait(unsigned int task);
+// blocks until any of the tasks has finished, then removes it from the list and returns it
+unsigned int task_wait_any(std::vector<unsigned int>* tasks);
+
+// runs the function on the calling thread so that it shows up in the trace, used for GL work on the main thread
+void task_run_here(const std::string& name, std::function<void()> function);
+void task_trace_print();
@@ -0,0 +1,474 @@
+#include "undo.hpp"
+
+#include "file.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+enum UndoType {
+    UNDO_MOVE_SECTORS,
+    UNDO_MOVE_VERTEX,
+    UNDO_MOVE_OBJECTS,
+    UNDO_SECTOR_PROPERTIES,
+    UNDO_WALL,
+    UNDO_ADD_SECTOR,
+    UNDO_DELETE_SECTOR,
+    UNDO_TURN_ENEMY,
+    UNDO_ADD_OBJECT,
+    UNDO_DELETE_OBJECT
+};
+
+// wall normals are rebuilt with the mesh, so only what the user can change is kept
+struct UndoWall {
+    unsigned int exists;
+    unsigned int texture_index;
+};
+
+std::vector<unsigned char> undo_log;
+// where each action starts in undo_log
+std::vector<size_t> undo_actions;
+// actions before this one have been applied, the ones from here on can be redone
+unsigned int undo_position = 0;
+
+template <typename T>
+void undo_write(const T& value) {
+    const unsigned char* bytes = (const unsigned char*)&value;
+    undo_log.insert(undo_log.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T undo_read(size_t* offset) {
+    T value;
+    memcpy(&value, &undo_log[*offset], sizeof(T));
+    *offset += sizeof(T);
+    return value;
+}
+
+SectorProperties sector_properties(const Sector& sector) {
+    return (SectorProperties) {
+        .floor_y = sector.floor_y,
+        .ceiling_y = sector.ceiling_y,
+        .floor_texture_index = sector.floor_texture_index,
+        .ceiling_texture_index = sector.ceiling_texture_index
+    };
+}
+
+void set_sector_properties(Sector* sector, SectorProperties properties) {
+    sector->floor_y = properties.floor_y;
+    sector->ceiling_y = properties.ceiling_y;
+    sector->floor_texture_index = properties.floor_texture_index;
+    sector->ceiling_texture_index = properties.ceiling_texture_index;
+}
+
+UndoWall undo_wall(const Wall& wall) {
+    return (UndoWall) {
+        .exists = wall.exists,
+        .texture_index = wall.texture_index
+    };
+}
+
+glm::vec3* undo_object_position(ObjectSelection object) {
+    if (object.type == OBJECT_ENEMY) {
+        return &enemy_spawns[object.index].position;
+    } else if (object.type == OBJECT_LIGHT) {
+        return &lights[object.index].position;
+    }
+    return &player_spawn_point;
+}
+
+void undo_clear() {
+    undo_log.clear();
+    undo_actions.clear();
+    undo_position = 0;
+}
+
+void undo_begin(UndoType type) {
+    // a new edit drops everything that could have been redone
+    if (undo_position < undo_actions.size()) {
+        undo_log.resize(undo_actions[undo_position]);
+        undo_actions.resize(undo_position);
+    }
+    undo_actions.push_back(undo_log.size());
+    undo_position++;
+    undo_write((unsigned char)type);
+}
+
+void undo_write_sector(const Sector& sector) {
+    undo_write(sector_properties(sector));
+    undo_write((unsigned int)sector.vertices.size());
+    for (unsigned int i = 0; i < sector.vertices.size(); i++) {
+        undo_write(sector.vertices[i]);
+        undo_write(undo_wall(sector.walls[i]));
+    }
+}
+
+Sector undo_read_sector(size_t* offset) {
+    Sector sector;
+    set_sector_properties(&sector, undo_read<SectorProperties>(offset));
+    unsigned int num_vertices = undo_read<unsigned int>(offset);
+    for (unsigned int i = 0; i < num_vertices; i++) {
+        glm::vec2 vertex = undo_read<glm::vec2>(offset);
+        UndoWall wall = undo_read<UndoWall>(offset);
+        sector.add_vertex(vertex, wall.texture_index, wall.exists != 0);
+    }
+
+    return sector;
+}
+
+void undo_record_move_sectors(const std::vector<unsigned int>& sector_indices, glm::vec2 movement) {
+    undo_begin(UNDO_MOVE_SECTORS);
+    undo_write(movement);
+    undo_write((unsigned int)sector_indices.size());
+    for (unsigned int sector : sector_indices) {
+        undo_write(sector);
+    }
+}
+
+void undo_record_move_vertex(unsigned int sector, unsigned int vertex, glm::vec2 movement) {
+    undo_begin(UNDO_MOVE_VERTEX);
+    undo_write(movement);
+    undo_write(sector);
+    undo_write(vertex);
+}
+
+void undo_record_move_objects(const std::vector<ObjectSelection>& objects, glm::vec3 movement) {
+    undo_begin(UNDO_MOVE_OBJECTS);
+    undo_write(movement);
+    undo_write((unsigned int)objects.size());
+    for (const ObjectSelection& object : objects) {
+        undo_write(object);
+    }
+}
+
+void undo_record_sector_properties(unsigned int sector, SectorProperties before) {
+    undo_begin(UNDO_SECTOR_PROPERTIES);
+    undo_write(sector);
+    undo_write(before);
+    undo_write(sector_properties(sectors[sector]));
+}
+
+void undo_record_wall(unsigned int sector, unsigned int wall, Wall before) {
+    undo_begin(UNDO_WALL);
+    undo_write(sector);
+    undo_write(wall);
+    undo_write(undo_wall(before));
+    undo_write(undo_wall(sectors[sector].walls[wall]));
+}
+
+void undo_record_add_sector(unsigned int sector) {
+    undo_begin(UNDO_ADD_SECTOR);
+    undo_write(sector);
+    undo_write_sector(sectors[sector]);
+}
+
+void undo_record_delete_sector(unsigned int sector) {
+    undo_begin(UNDO_DELETE_SECTOR);
+    undo_write(sector);
+    undo_write_sector(sectors[sector]);
+}
+
+void undo_record_turn_enemy(unsigned int enemy, glm::vec2 before) {
+    undo_begin(UNDO_TURN_ENEMY);
+    undo_write(enemy);
+    undo_write(before);
+    undo_write(enemy_spawns[enemy].direction);
+}
+
+void undo_write_object(ObjectSelection object) {
+    undo_write(object);
+    if (object.type == OBJECT_ENEMY) {
+        undo_write(enemy_spawns[object.index]);
+    } else if (object.type == OBJECT_LIGHT) {
+        undo_write(lights[object.index]);
+    }
+}
+
+void undo_record_add_object(ObjectSelection object) {
+    undo_begin(UNDO_ADD_OBJECT);
+    undo_write_object(object);
+}
+
+void undo_record_delete_object(ObjectSelection object) {
+    undo_begin(UNDO_DELETE_OBJECT);
+    undo_write_object(object);
+}
+
+void undo_apply(unsigned int action, bool forward, UndoChange* change) {
+    change->sectors.clear();
+    change->inserted_sector = -1;
+    change->erased_sector = -1;
+    change->vertex_sector = -1;
+    change->objects.clear();
+    change->objects_reindexed = false;
+
+    size_t offset = undo_actions[action];
+    UndoType type = (UndoType)undo_read<unsigned char>(&offset);
+    float sign = forward ? 1.0f : -1.0f;
+
+    if (type == UNDO_MOVE_SECTORS) {
+        glm::vec2 movement = undo_read<glm::vec2>(&offset) * sign;
+        unsigned int num_sectors = undo_read<unsigned int>(&offset);
+        for (unsigned int i = 0; i < num_sectors; i++) {
+            unsigned int sector = undo_read<unsigned int>(&offset);
+            for (glm::vec2& vertex : sectors[sector].vertices) {
+                vertex += movement;
+            }
+            change->sectors.push_back(sector);
+        }
+    } else if (type == UNDO_MOVE_VERTEX) {
+        glm::vec2 movement = undo_read<glm::vec2>(&offset) * sign;
+        unsigned int sector = undo_read<unsigned int>(&offset);
+        unsigned int vertex = undo_read<unsigned int>(&offset);
+        sectors[sector].vertices[vertex] += movement;
+        change->sectors.push_back(sector);
+        change->vertex_sector = sector;
+    } else if (type == UNDO_MOVE_OBJECTS) {
+        glm::vec3 movement = undo_read<glm::vec3>(&offset) * sign;
+        unsigned int num_objects = undo_read<unsigned int>(&offset);
+        for (unsigned int i = 0; i < num_objects; i++) {
+            ObjectSelection object = undo_read<ObjectSelection>(&offset);
+            *undo_object_position(object) += movement;
+            change->objects.push_back(object);
+        }
+    } else if (type == UNDO_SECTOR_PROPERTIES) {
+        unsigned int sector = undo_read<unsigned int>(&offset);
+        SectorProperties before = undo_read<SectorProperties>(&offset);
+        SectorProperties after = undo_read<SectorProperties>(&offset);
+        set_sector_properties(&sectors[sector], forward ? after : before);
+        change->sectors.push_back(sector);
+    } else if (type == UNDO_WALL) {
+        unsigned int sector = undo_read<unsigned int>(&offset);
+        unsigned int wall = undo_read<unsigned int>(&offset);
+        UndoWall before = undo_read<UndoWall>(&offset);
+        UndoWall after = undo_read<UndoWall>(&offset);
+        UndoWall state = forward ? after : before;
+        sectors[sector].walls[wall].exists = state.exists != 0;
+        sectors[sector].walls[wall].texture_index = state.texture_index;
+        change->sectors.push_back(sector);
+        change->vertex_sector = sector;
+    } else if (type == UNDO_ADD_SECTOR || type == UNDO_DELETE_SECTOR) {
+        unsigned int sector = undo_read<unsigned int>(&offset);
+        // undoing an add is the same as redoing a delete
+        bool is_insert = (type == UNDO_ADD_SECTOR) == forward;
+        if (is_insert) {
+            sectors.insert(sectors.begin() + sector, undo_read_sector(&offset));
+            change->inserted_sector = sector;
+            change->sectors.push_back(sector);
+        } else {
+            sectors.erase(sectors.begin() + sector);
+            change->erased_sector = sector;
+        }
+    } else if (type == UNDO_TURN_ENEMY) {
+        unsigned int enemy = undo_read<unsigned int>(&offset);
+        glm::vec2 before = undo_read<glm::vec2>(&offset);
+        glm::vec2 after = undo_read<glm::vec2>(&offset);
+        enemy_spawns[enemy].direction = forward ? after : before;
+        change->objects.push_back({ .type = OBJECT_ENEMY, .index = enemy });
+    } else if (type == UNDO_ADD_OBJECT || type == UNDO_DELETE_OBJECT) {
+        ObjectSelection object = undo_read<ObjectSelection>(&offset);
+        bool is_insert = (type == UNDO_ADD_OBJECT) == forward;
+        if (object.type == OBJECT_ENEMY) {
+            EnemySpawn enemy_spawn = undo_read<EnemySpawn>(&offset);
+            if (is_insert) {
+                enemy_spawns.insert(enemy_spawns.begin() + object.index, enemy_spawn);
+            } else {
+                enemy_spawns.erase(enemy_spawns.begin() + object.index);
+            }
+        } else if (object.type == OBJECT_LIGHT) {
+            PointLight light = undo_read<PointLight>(&offset);
+            if (is_insert) {
+                lights.insert(lights.begin() + object.index, light);
+            } else {
+                lights.erase(lights.begin() + object.index);
+            }
+        }
+        if (is_insert) {
+            change->objects.push_back(object);
+        }
+        change->objects_reindexed = true;
+    }
+}
+
+bool undo_undo(UndoChange* change) {
+    if (undo_position == 0) {
+        return false;
+    }
+
+    undo_position--;
+    undo_apply(undo_position, false, change);
+    return true;
+}
+
+bool undo_redo(UndoChange* change) {
+    if (undo_position == undo_actions.size()) {
+        return false;
+    }
+
+    undo_apply(undo_position, true, change);
+    undo_position++;
+    return true;
+}
+
+size_t undo_memory_usage() {
+    return undo_log.capacity() + (undo_actions.capacity() * sizeof(size_t));
+}
+
+uint64_t undo_level_hash() {
+    uint64_t hash = FILE_HASH_SEED;
+    for (const Sector& sector : sectors) {
+        SectorProperties properties = sector_properties(sector);
+        hash = file_hash(&properties, sizeof(properties), hash);
+        for (unsigned int i = 0; i < sector.vertices.size(); i++) {
+            UndoWall wall = undo_wall(sector.walls[i]);
+            hash = file_hash(&sector.vertices[i], sizeof(glm::vec2), hash);
+            hash = file_hash(&wall, sizeof(wall), hash);
+        }
+    }
+    hash = file_hash(enemy_spawns.data(), enemy_spawns.size() * sizeof(EnemySpawn), hash);
+    hash = file_hash(lights.data(), lights.size() * sizeof(PointLight), hash);
+    return file_hash(&player_spawn_point, sizeof(glm::vec3), hash);
+}
+
+// what one full copy of the level data takes, which is what a snapshot based history would store per edit
+size_t undo_level_size() {
+    size_t size = 0;
+    for (const Sector& sector : sectors) {
+        size += sizeof(Sector) + (sector.vertices.size() * sizeof(glm::vec2)) + (sector.walls.size() * sizeof(Wall));
+    }
+    return size + (enemy_spawns.size() * sizeof(EnemySpawn)) + (lights.size() * sizeof(PointLight));
+}
+
+float undo_elapsed_ms(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void undo_add_room(glm::vec2 corner) {
+    Sector sector;
+    sector.add_vertex(corner, 0, true);
+    sector.add_vertex(corner + glm::vec2(3.0f, 0.0f), 0, true);
+    sector.add_vertex(corner + glm::vec2(3.0f, 3.0f), 0, true);
+    sector.add_vertex(corner + glm::vec2(0.0f, 3.0f), 0, true);
+    sectors.push_back(sector);
+}
+
+void undo_benchmark(unsigned int num_sectors) {
+    // a grid of square rooms like pick_benchmark, with an enemy and a light in every tenth room
+    unsigned int grid_size = 1;
+    while (grid_size * grid_size < num_sectors) {
+        grid_size++;
+    }
+    sectors.clear();
+    enemy_spawns.clear();
+    lights.clear();
+    for (unsigned int i = 0; i < num_sectors; i++) {
+        glm::vec2 corner = glm::vec2((i % grid_size) * 4.0f, (i / grid_size) * 4.0f);
+        undo_add_room(corner);
+        if (i % 10 == 0) {
+            enemy_spawns.push_back({
+                .position = glm::vec3(corner.x + 1.5f, 0.0f, corner.y + 1.5f),
+                .direction = glm::vec2(0.0f, 1.0f)
+            });
+            lights.push_back({
+                .position = glm::vec3(corner.x + 1.5f, 1.0f, corner.y + 1.5f),
+                .constant = 1.0f,
+                .linear = 0.022f,
+                .quadratic = 0.0019f
+            });
+        }
+    }
+    player_spawn_point = glm::vec3(1.5f, 0.0f, 1.5f);
+    undo_clear();
+    srand(1);
+
+    size_t level_size = undo_level_size();
+    uint64_t start_hash = undo_level_hash();
+
+    // the same kinds of edits the editor makes, one per sector in the map
+    unsigned int num_edits = num_sectors;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < num_edits; i++) {
+        unsigned int kind = rand() % 8;
+        unsigned int sector = rand() % sectors.size();
+        glm::vec2 movement = glm::vec2((rand() % 17) - 8, (rand() % 17) - 8) / 8.0f;
+        if (kind == 0) {
+            std::vector<unsigned int> moved = { sector };
+            if (rand() % 2 == 0 && sectors.size() > 1) {
+                moved.push_back((sector + 1) % sectors.size());
+            }
+            for (unsigned int moved_sector : moved) {
+                for (glm::vec2& vertex : sectors[moved_sector].vertices) {
+                    vertex += movement;
+                }
+            }
+            undo_record_move_sectors(moved, movement);
+        } else if (kind == 1) {
+            unsigned int vertex = rand() % sectors[sector].vertices.size();
+            sectors[sector].vertices[vertex] += movement;
+            undo_record_move_vertex(sector, vertex, movement);
+        } else if (kind == 2) {
+            SectorProperties before = sector_properties(sectors[sector]);
+            sectors[sector].ceiling_y += (rand() % 4) + 1;
+            sectors[sector].floor_texture_index = rand() % 8;
+            undo_record_sector_properties(sector, before);
+        } else if (kind == 3) {
+            unsigned int wall = rand() % sectors[sector].walls.size();
+            Wall before = sectors[sector].walls[wall];
+            sectors[sector].walls[wall].exists = !before.exists;
+            sectors[sector].walls[wall].texture_index = rand() % 8;
+            undo_record_wall(sector, wall, before);
+        } else if (kind == 4) {
+            undo_add_room(glm::vec2(rand() % (grid_size * 4), rand() % (grid_size * 4)));
+            undo_record_add_sector(sectors.size() - 1);
+        } else if (kind == 5 && sectors.size() > 1) {
+            undo_record_delete_sector(sector);
+            sectors.erase(sectors.begin() + sector);
+        } else if (kind == 6 && !lights.empty()) {
+            std::vector<ObjectSelection> moved = {
+                { .type = OBJECT_PLAYER, .index = 0 },
+                { .type = OBJECT_LIGHT, .index = (unsigned int)(rand() % lights.size()) }
+            };
+            for (const ObjectSelection& object : moved) {
+                *undo_object_position(object) += glm::vec3(movement.x, 0.0f, movement.y);
+            }
+            undo_record_move_objects(moved, glm::vec3(movement.x, 0.0f, movement.y));
+        } else if (kind == 7 && !enemy_spawns.empty()) {
+            ObjectSelection enemy = { .type = OBJECT_ENEMY, .index = (unsigned int)(rand() % enemy_spawns.size()) };
+            if (rand() % 2 == 0) {
+                undo_record_delete_object(enemy);
+                enemy_spawns.erase(enemy_spawns.begin() + enemy.index);
+            } else {
+                glm::vec2 before = enemy_spawns[enemy.index].direction;
+                enemy_spawns[enemy.index].direction = glm::vec2(before.y, -before.x);
+                undo_record_turn_enemy(enemy.index, before);
+            }
+        } else {
+            i--;
+        }
+    }
+    float record_time = undo_elapsed_ms(start_time);
+    uint64_t end_hash = undo_level_hash();
+
+    UndoChange change;
+    unsigned int num_undone = 0;
+    start_time = std::chrono::steady_clock::now();
+    while (undo_undo(&change)) {
+        num_undone++;
+    }
+    float undo_time = undo_elapsed_ms(start_time);
+    bool undo_matches = undo_level_hash() == start_hash;
+
+    start_time = std::chrono::steady_clock::now();
+    while (undo_redo(&change)) { }
+    float redo_time = undo_elapsed_ms(start_time);
+    bool redo_matches = undo_level_hash() == end_hash;
+
+    size_t history_size = undo_memory_usage();
+    printf("Undo benchmark, %u edits on a %u sector map\n", num_undone, num_sectors);
+    printf("  history    %10.1f KB, %.1f bytes per edit (%.1f KB of log in use)\n", history_size / 1024.0f, (float)history_size / num_edits, (undo_log.size() + (undo_actions.size() * sizeof(size_t))) / 1024.0f);
+    printf("  snapshots  %10.1f KB per copy of the map, %.1f MB for one copy per edit\n", level_size / 1024.0f, ((float)level_size * num_edits) / (1024.0f * 1024.0f));
+    printf("  record     %10.3f us per edit\n", (record_time * 1000.0f) / num_edits);
+    printf("  undo all   %10.2f ms, level %s\n", undo_time, undo_matches ? "matches the original" : "DOES NOT match the original");
+    printf("  redo all   %10.2f ms, level %s\n", redo_time, redo_matches ? "matches the edited one" : "DOES NOT match the edited one");
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "edit.hpp"
+#include "level.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// the editor's undo history
+// every edit is appended to one byte log as the smallest change that can be applied in both directions,
+// so the history grows with the size of the edits and not with the size of the map
+
+struct SectorProperties {
+    float floor_y;
+    float ceiling_y;
+    unsigned int floor_texture_index;
+    unsigned int ceiling_texture_index;
+};
+
+// what an undo or redo touched, so that the editor can rebuild and select it
+struct UndoChange {
+    // sectors whose mesh is out of date, indices are the ones after the change
+    std::vector<unsigned int> sectors;
+    int inserted_sector;
+    int erased_sector;
+    // set when the change was to a single vertex of this sector
+    int vertex_sector;
+    std::vector<ObjectSelection> objects;
+    // an enemy or light was inserted or erased, so object indices after it moved
+    bool objects_reindexed;
+};
+
+SectorProperties sector_properties(const Sector& sector);
+
+void undo_clear();
+// all of these are called after the edit was made, except for deletes which are called before the erase
+void undo_record_move_sectors(const std::vector<unsigned int>& sector_indices, glm::vec2 movement);
+void undo_record_move_vertex(unsigned int sector, unsigned int vertex, glm::vec2 movement);
+void undo_record_move_objects(const std::vector<ObjectSelection>& objects, glm::vec3 movement);
+void undo_record_sector_properties(unsigned int sector, SectorProperties before);
+void undo_record_wall(unsigned int sector, unsigned int wall, Wall before);
+void undo_record_add_sector(unsigned int sector);
+void undo_record_delete_sector(unsigned int sector);
+void undo_record_turn_enemy(unsigned int enemy, glm::vec2 before);
+void undo_record_add_object(ObjectSelection object);
+void undo_record_delete_object(ObjectSelection object);
+
+// only change the level data, rebuilding meshes is left to the caller through the change
+bool undo_undo(UndoChange* change);
+bool undo_redo(UndoChange* change);
+size_t undo_memory_usage();
+// covers everything an edit can change, so the editor can tell when its baked lighting is out of date
+uint64_t undo_level_hash();
+
+void undo_benchmark(unsigned int num_sectors);